@@ -0,0 +1,1428 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "compiled.hpp"
+#include "lorg.hpp"
+#include "output.hpp"
+#include "thread_pool.hpp"
+#include "unit_sum.hpp"
+
+constexpr int EXIT_CODE_OK = 0;
+constexpr int EXIT_CODE_ERROR_ARGUMENTS = 1;
+constexpr int EXIT_CODE_ERROR_PARSE = 2;
+constexpr int EXIT_CODE_ERROR_ALLOCATIONS = 3;
+
+constexpr size_t DEFAULT_NODE_COUNT = 1000000;
+constexpr size_t UNIT_COUNT = 40;
+
+// The title line of a node has as many characters as its level, so a chain
+// content grows with the square of its node count.
+constexpr size_t CHAIN_NODE_COUNT = 10000;
+
+// The mean number of comment lines per node of the content parsed again to
+// count the allocations of the comment lines.
+constexpr double ALLOCATION_COMMENT_DENSITY = 4.0;
+
+// The compiled tree of a content of this many nodes is corrupted this many
+// times, flipping one bit each time, then used to parse the content again.
+constexpr size_t CORRUPTED_NODE_COUNT = 1000;
+constexpr size_t CORRUPTION_COUNT = 300;
+
+// The batch benchmark parses this many files of this many nodes, small enough
+// to be parsed on a single thread each, on a pool with more threads than
+// files, like `lorg --jobs 8` with a few project files.
+constexpr size_t BATCH_FILE_COUNT = 4;
+constexpr size_t BATCH_NODE_COUNT = 4000;
+constexpr size_t MIN_BATCH_THREAD_COUNT = 2 * BATCH_FILE_COUNT;
+
+// The wide trees streamed to check the memory of `parse_stream()` have this
+// many leaves, and the peak resident size must not grow by more than this
+// while they are parsed. Keeping 8 bytes per node would take twice as much.
+constexpr size_t WIDE_STREAM_LEAF_COUNT = 2000000;
+constexpr uint64_t MAX_STREAM_RESIDENT_GROWTH = 8 << 20;
+
+// The number of paths looked up in the index benchmark.
+constexpr size_t INDEX_LOOKUP_COUNT = 200;
+
+// The unit summation kernels add this many children rows to a parent row
+// until about `UNIT_SUM_ADDITION_COUNT` units are added.
+constexpr size_t UNIT_SUM_CHILD_COUNT = 1 << 10;
+constexpr size_t UNIT_SUM_ADDITION_COUNT = size_t(1) << 28;
+
+// With `--check`, the contents have this many nodes by default and the unit
+// summation kernels add this many units, so the checks run in a few seconds.
+constexpr size_t CHECK_NODE_COUNT = 20000;
+constexpr size_t CHECK_UNIT_SUM_ADDITION_COUNT = size_t(1) << 22;
+
+// The benchmarks that check their results, and fail when they are wrong.
+constexpr char const * CHECK_NAMES[] = {
+	"batch", "incremental", "corruption", "allocations", "index", "node-tree", "unit-sum",
+	"stream-memory"
+};
+
+// The printed trees are built directly, a chain this deep would need a huge
+// content. Only the compact JSON of the chain is printed: the other formats
+// indent each line by its level, so their size grows with the square of the
+// depth.
+constexpr size_t PRINT_CHAIN_NODE_COUNT = 100000;
+constexpr size_t PRINT_FAN_OUT_NODE_COUNT = 1000000;
+constexpr size_t PRINT_UNIT_COUNT = 4;
+
+// The generated contents deeper than this are also only printed in compact
+// JSON.
+constexpr size_t MAX_INDENTED_PRINT_DEPTH = 100;
+
+#if defined(_WIN32)
+constexpr char const * NULL_DEVICE_PATH = "NUL";
+#else
+constexpr char const * NULL_DEVICE_PATH = "/dev/null";
+#endif
+
+// The shape of a generated content. The generation is deterministic, so the
+// same options give the same content on all machines and the measures can be
+// compared between runs.
+struct GeneratorOptions
+{
+	size_t node_count = DEFAULT_NODE_COUNT;
+	// The maximum level of the nodes.
+	size_t depth = 12;
+	// The mean number of children of the nodes above the maximum level. The
+	// number of nodes of level 1 is only limited by the node count.
+	size_t fan_out = 4;
+	// The number of units defined in each node, among `UNIT_COUNT` names. The
+	// other units are calculated.
+	size_t units_per_node = 2;
+	// The mean number of comment lines after each node.
+	double comment_density = 1.0;
+	// The part of the lines ending with `\r\n` instead of `\n`.
+	double crlf_ratio = 0.0;
+	uint32_t seed = 42;
+};
+
+// Returns true with the given probability. The distributions of the standard
+// library are not the same on all platforms, the generator is.
+bool draw(std::mt19937 & generator, double probability)
+{
+	return static_cast<double>(generator()) < probability * 4294967296.0;
+}
+
+void end_line(std::string & content, std::mt19937 & generator, double crlf_ratio)
+{
+	if(crlf_ratio > 0.0 && draw(generator, crlf_ratio))
+	{
+		content += '\r';
+	}
+	content += '\n';
+}
+
+// Generate a Lorg content. Each node has a random number of children between
+// 1 and `2 * fan_out - 1` until the maximum depth, so a depth of the node count
+// with a fan-out of 1 gives a chain, the deepest tree possible.
+std::string generate_content(GeneratorOptions const & options)
+{
+	// The comments and the line endings are drawn apart, so they do not
+	// change the tree.
+	std::mt19937 generator(options.seed);
+	std::mt19937 layout_generator(options.seed + 1);
+	std::string content;
+	size_t const comment_count = static_cast<size_t>(options.comment_density);
+	double const extra_comment_probability = (
+		options.comment_density - static_cast<double>(comment_count)
+	);
+
+	// The number of children left to generate for each node of the current
+	// branch. The node `k` is of level `k + 1`.
+	std::vector<size_t> remaining_child_counts;
+	for(size_t i = 0; i < options.node_count; i++)
+	{
+		while(!remaining_child_counts.empty() && remaining_child_counts.back() == 0)
+		{
+			remaining_child_counts.pop_back();
+		}
+		if(!remaining_child_counts.empty())
+		{
+			remaining_child_counts.back()--;
+		}
+		size_t const level = remaining_child_counts.size() + 1;
+		content.append(level, lorg::NODE_DEFINITION_CHARACTER);
+		content += " Node " + std::to_string(i);
+		end_line(content, layout_generator, options.crlf_ratio);
+
+		for(size_t n = 0; n < options.units_per_node; n++)
+		{
+			content += "$ Unit " + std::to_string(generator() % UNIT_COUNT);
+			content += ": " + std::to_string(generator() % 1000) + ".5";
+			end_line(content, layout_generator, options.crlf_ratio);
+		}
+
+		size_t const node_comment_count = comment_count + (
+			extra_comment_probability > 0.0 && draw(layout_generator, extra_comment_probability) ? 1 : 0
+		);
+		for(size_t n = 0; n < node_comment_count; n++)
+		{
+			content += "A comment about the node.";
+			end_line(content, layout_generator, options.crlf_ratio);
+		}
+
+		remaining_child_counts.push_back(
+			level < options.depth ? 1 + generator() % (2 * options.fan_out - 1) : 0
+		);
+	}
+	return content;
+}
+
+double get_elapsed_seconds(std::chrono::steady_clock::time_point const & start)
+{
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+// Where the measures are written. In text, each benchmark starts with a line
+// describing it, followed by one line per stage. In JSON, each measure is an
+// object on its own line, so the results of several runs can be appended.
+struct Report
+{
+	bool to_json = false;
+	std::string benchmark;
+};
+
+void start_benchmark(Report & report, std::string const & name, std::string const & description)
+{
+	report.benchmark = name;
+	if(!report.to_json)
+	{
+		std::cout << name << ": " << description << '\n';
+	}
+}
+
+// Write the measure of a stage of the current benchmark, which processed
+// `byte_count` bytes and `node_count` nodes with `jobs` threads. The
+// throughputs that are zero are not written.
+void report_measure(
+	Report const & report, std::string const & stage, double seconds,
+	size_t byte_count, size_t node_count, size_t jobs = 1
+)
+{
+	double const megabytes_per_second = (
+		seconds > 0.0 ? static_cast<double>(byte_count) / seconds / 1e6 : 0.0
+	);
+	double const nodes_per_second = (
+		seconds > 0.0 ? static_cast<double>(node_count) / seconds : 0.0
+	);
+	if(report.to_json)
+	{
+		// The names have no characters to escape.
+		std::cout << "{\"benchmark\": \"" << report.benchmark << "\", ";
+		std::cout << "\"stage\": \"" << stage << "\", \"jobs\": " << jobs << ", ";
+		std::cout << "\"seconds\": " << seconds << ", ";
+		std::cout << "\"bytes\": " << byte_count << ", \"nodes\": " << node_count;
+		if(megabytes_per_second > 0.0)
+		{
+			std::cout << ", \"mb_per_second\": " << megabytes_per_second;
+		}
+		if(nodes_per_second > 0.0)
+		{
+			std::cout << ", \"nodes_per_second\": " << nodes_per_second;
+		}
+		std::cout << "}" << '\n';
+		return;
+	}
+
+	std::cout << "  " << stage;
+	if(jobs > 1)
+	{
+		std::cout << " (" << jobs << " jobs)";
+	}
+	std::cout << ": " << seconds << " s";
+	if(megabytes_per_second > 0.0)
+	{
+		std::cout << ", " << megabytes_per_second << " MB/s";
+	}
+	if(nodes_per_second > 0.0)
+	{
+		std::cout << ", " << nodes_per_second / 1e6 << " M nodes/s";
+	}
+	std::cout << '\n';
+}
+
+// Write the allocations made by a stage of the current benchmark for
+// `line_count` lines.
+void report_allocations(
+	Report const & report, std::string const & stage, uint64_t allocation_count,
+	size_t line_count
+)
+{
+	double const allocations_per_line = (
+		line_count > 0 ? static_cast<double>(allocation_count) / static_cast<double>(line_count) : 0.0
+	);
+	if(report.to_json)
+	{
+		std::cout << "{\"benchmark\": \"" << report.benchmark << "\", ";
+		std::cout << "\"stage\": \"" << stage << "\", ";
+		std::cout << "\"allocations\": " << allocation_count << ", \"lines\": " << line_count;
+		std::cout << ", \"allocations_per_line\": " << allocations_per_line << "}" << '\n';
+		return;
+	}
+	std::cout << "  " << stage << ": " << allocation_count << " allocations, ";
+	std::cout << allocations_per_line << " per line" << '\n';
+}
+
+std::FILE * open_file_or_exit(char const * path, char const * mode)
+{
+	std::FILE * file = std::fopen(path, mode);
+	if(file == nullptr)
+	{
+		std::cerr << "\"" << path << "\" cannot be written." << std::endl;
+		exit(EXIT_CODE_ERROR_ARGUMENTS);
+	}
+	return file;
+}
+
+// Measure the printing of the tree to the null device.
+void run_print_benchmark(
+	Report const & report, std::string const & stage, lorg::TreeView const & tree,
+	std::vector<lorg::UnitDefinition> const & unit_definitions,
+	lorg::PrinterOptions const & options
+)
+{
+	std::FILE * file = open_file_or_exit(NULL_DEVICE_PATH, "w");
+	double seconds = 0.0;
+	size_t printed_size = 0;
+	{
+		lorg::Output output(file);
+		lorg::Printer printer(output, options, unit_definitions);
+		auto start = std::chrono::steady_clock::now();
+		lorg::print_tree(printer, tree, false);
+		seconds = get_elapsed_seconds(start);
+		printed_size = output.get_written_size();
+	}
+	std::fclose(file);
+	// The total node is not printed.
+	report_measure(report, stage, seconds, printed_size, tree.node_count - 1);
+}
+
+// Run the printers in all the formats, or only the compact JSON one when
+// `is_deep` is true.
+void run_print_benchmarks(
+	Report const & report, lorg::TreeView const & tree,
+	std::vector<lorg::UnitDefinition> const & unit_definitions, bool is_deep
+)
+{
+	lorg::PrinterOptions options;
+	for(bool to_json : {false, true})
+	{
+		for(bool prettify : {false, true})
+		{
+			if(is_deep && (!to_json || prettify))
+			{
+				continue;
+			}
+			options.to_json = to_json;
+			options.prettify = prettify;
+			std::string stage = to_json ? "print json" : "print simple";
+			if(prettify)
+			{
+				stage += " pretty";
+			}
+			run_print_benchmark(report, stage, tree, unit_definitions, options);
+		}
+	}
+}
+
+// Measure the steps of `lorg::parse()` with one thread and with one thread per
+// core, then the printers on the calculated tree. The throughputs are the
+// ones of the content for the steps, and the ones of the printed text for the
+// printers.
+void run_benchmark(
+	Report & report, std::string const & name, GeneratorOptions const & generator_options
+)
+{
+	std::string const content = generate_content(generator_options);
+	size_t const node_count = generator_options.node_count;
+
+	auto start = std::chrono::steady_clock::now();
+	lorg::ParserResult result = lorg::convert_string_to_nodes(content);
+	double const parse_seconds = get_elapsed_seconds(start);
+	if(result.has_error)
+	{
+		std::cerr << result.error_message << std::endl;
+		exit(EXIT_CODE_ERROR_PARSE);
+	}
+
+	start = std::chrono::steady_clock::now();
+	lorg::update_node_unit_values(result);
+	double const update_seconds = get_elapsed_seconds(start);
+
+	std::string description = std::to_string(node_count) + " nodes, ";
+	description += std::to_string(result.unit_definitions.size()) + " units, ";
+	description += std::to_string(content.size()) + " bytes";
+	start_benchmark(report, name, description);
+	report_measure(report, "convert_string_to_nodes", parse_seconds, content.size(), node_count);
+	report_measure(report, "update_node_unit_values", update_seconds, content.size(), node_count);
+
+	// Same steps with one thread per core, when there are several.
+	lorg::ParserOptions options;
+	options.jobs = std::max(std::thread::hardware_concurrency(), 1u);
+	if(options.jobs > 1)
+	{
+		start = std::chrono::steady_clock::now();
+		lorg::ParserResult parallel_result = lorg::convert_string_to_nodes(content, options);
+		double const parallel_parse_seconds = get_elapsed_seconds(start);
+
+		start = std::chrono::steady_clock::now();
+		lorg::update_node_unit_values(parallel_result, options);
+		double const parallel_update_seconds = get_elapsed_seconds(start);
+
+		report_measure(
+			report, "convert_string_to_nodes", parallel_parse_seconds, content.size(),
+			node_count, options.jobs
+		);
+		report_measure(
+			report, "update_node_unit_values", parallel_update_seconds, content.size(),
+			node_count, options.jobs
+		);
+	}
+
+	run_print_benchmarks(
+		report, result.tree.get_view(), result.unit_definitions,
+		generator_options.depth > MAX_INDENTED_PRINT_DEPTH
+	);
+
+	start = std::chrono::steady_clock::now();
+	result = lorg::ParserResult();
+	double const release_seconds = get_elapsed_seconds(start);
+	report_measure(report, "release", release_seconds, 0, node_count);
+}
+
+// Parse a content again after changing one unit value in its middle, as
+// an edit of a large file would.
+void run_incremental_benchmark(Report & report, GeneratorOptions const & generator_options)
+{
+	std::string content = generate_content(generator_options);
+	size_t const node_count = generator_options.node_count;
+	lorg::ParserResult previous = lorg::parse(content);
+	if(previous.has_error)
+	{
+		std::cerr << previous.error_message << std::endl;
+		exit(EXIT_CODE_ERROR_PARSE);
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<uint64_t> const previous_node_hashes = lorg::hash_node_contents(content);
+	double const hash_seconds = get_elapsed_seconds(start);
+
+	size_t const value_separator = content.find(": ", content.size() / 2);
+	if(value_separator == std::string::npos)
+	{
+		return;
+	}
+	size_t const value_start = value_separator + 2;
+	content.replace(value_start, content.find('\n', value_start) - value_start, "123");
+
+	start = std::chrono::steady_clock::now();
+	lorg::ParserResult const result = lorg::parse(content);
+	double const parse_seconds = get_elapsed_seconds(start);
+
+	std::vector<uint64_t> node_hashes;
+	start = std::chrono::steady_clock::now();
+	lorg::ParserResult const incremental_result = lorg::parse_incrementally(
+		content, std::move(previous), previous_node_hashes.data(), node_hashes
+	);
+	double const incremental_seconds = get_elapsed_seconds(start);
+	if(incremental_result.tree.values != result.tree.values)
+	{
+		std::cerr << "The incremental parse differs from the whole parse." << std::endl;
+		exit(EXIT_CODE_ERROR_PARSE);
+	}
+
+	start_benchmark(
+		report, "Incremental parse", std::to_string(node_count) + " nodes, one value changed"
+	);
+	report_measure(report, "hash_node_contents", hash_seconds, content.size(), node_count);
+	report_measure(report, "parse", parse_seconds, content.size(), node_count);
+	report_measure(
+		report, "parse_incrementally", incremental_seconds, content.size(), node_count
+	);
+}
+
+// Parse a few small files on a pool with more threads than files, one after
+// another on all the threads, then at the same time with one task per file,
+// the way `lorg --jobs` loads the files of a batch.
+void run_batch_benchmark(Report & report, GeneratorOptions const & generator_options)
+{
+	std::vector<std::string> contents;
+	size_t byte_count = 0;
+	for(size_t k = 0; k < BATCH_FILE_COUNT; k++)
+	{
+		GeneratorOptions file_options = generator_options;
+		file_options.node_count = BATCH_NODE_COUNT;
+		file_options.seed = generator_options.seed + static_cast<uint32_t>(k);
+		contents.push_back(generate_content(file_options));
+		byte_count += contents.back().size();
+	}
+	size_t const node_count = BATCH_FILE_COUNT * BATCH_NODE_COUNT;
+	size_t const jobs = std::max<size_t>(
+		std::thread::hardware_concurrency(), MIN_BATCH_THREAD_COUNT
+	);
+	lorg::ThreadPool pool(jobs);
+
+	std::vector<lorg::ParserResult> results(BATCH_FILE_COUNT);
+	auto start = std::chrono::steady_clock::now();
+	for(size_t k = 0; k < BATCH_FILE_COUNT; k++)
+	{
+		results[k] = lorg::parse(contents[k], &pool);
+	}
+	double const serial_seconds = get_elapsed_seconds(start);
+
+	std::vector<lorg::ParserResult> concurrent_results(BATCH_FILE_COUNT);
+	start = std::chrono::steady_clock::now();
+	lorg::run_in_parallel(
+		&pool, BATCH_FILE_COUNT,
+		[&contents, &concurrent_results](size_t k)
+		{
+			concurrent_results[k] = lorg::parse(contents[k], nullptr);
+		}
+	);
+	double const concurrent_seconds = get_elapsed_seconds(start);
+	for(size_t k = 0; k < BATCH_FILE_COUNT; k++)
+	{
+		if(
+			results[k].has_error ||
+			concurrent_results[k].tree.values != results[k].tree.values
+		)
+		{
+			std::cerr << "The files parsed at the same time differ." << std::endl;
+			exit(EXIT_CODE_ERROR_PARSE);
+		}
+	}
+
+	std::string description = std::to_string(BATCH_FILE_COUNT) + " files of ";
+	description += std::to_string(BATCH_NODE_COUNT) + " nodes, ";
+	description += std::to_string(byte_count) + " bytes";
+	start_benchmark(report, "Batch of small files", description);
+	report_measure(report, "parse one file at a time", serial_seconds, byte_count, node_count, jobs);
+	report_measure(
+		report, "parse the files at the same time", concurrent_seconds, byte_count, node_count, jobs
+	);
+}
+
+bool are_trees_equal(lorg::ParserResult const & a, lorg::ParserResult const & b)
+{
+	if(a.unit_definitions.size() != b.unit_definitions.size())
+	{
+		return false;
+	}
+	for(size_t id = 0; id < a.unit_definitions.size(); id++)
+	{
+		if(a.unit_definitions[id].name != b.unit_definitions[id].name)
+		{
+			return false;
+		}
+	}
+	return (
+		a.tree.parents == b.tree.parents &&
+		a.tree.subtree_ends == b.tree.subtree_ends &&
+		a.tree.depths == b.tree.depths &&
+		a.tree.titles == b.tree.titles &&
+		a.tree.title_offsets == b.tree.title_offsets &&
+		a.tree.values == b.tree.values &&
+		a.tree.real_masks == b.tree.real_masks &&
+		a.tree.ignored_masks == b.tree.ignored_masks
+	);
+}
+
+// Print a compiled tree read without its content check in all the formats,
+// then through the selection with its index, like `lorg` and `lorg --select`
+// do, to the null device. Each is only printed if the links it walks are
+// correct. Returns the number of prints.
+size_t print_corrupted_tree(lorg::CompiledTree const & compiled)
+{
+	lorg::PathPattern pattern;
+	pattern.titles.emplace_back();
+	pattern.titles.back().parts.emplace_back("Node 0");
+	std::vector<lorg::PathPattern> const selection = {pattern};
+
+	size_t print_count = 0;
+	std::FILE * file = open_file_or_exit(NULL_DEVICE_PATH, "w");
+	{
+		lorg::Output output(file);
+		lorg::PrinterOptions options;
+		if(lorg::is_compiled_tree_correct(compiled))
+		{
+			for(bool to_json : {false, true})
+			{
+				for(bool prettify : {false, true})
+				{
+					options.to_json = to_json;
+					options.prettify = prettify;
+					lorg::Printer printer(output, options, compiled.unit_definitions);
+					lorg::print_tree(printer, compiled.tree, true);
+				}
+			}
+			print_count++;
+		}
+		std::vector<size_t> selected_nodes;
+		if(lorg::select_nodes_checked(compiled.tree, selection, compiled.index, selected_nodes))
+		{
+			lorg::Printer printer(output, options, compiled.unit_definitions);
+			lorg::print_subtrees(printer, compiled.tree, selected_nodes);
+			print_count++;
+		}
+	}
+	std::fclose(file);
+	return print_count;
+}
+
+// Parse a content again from its compiled tree with one bit flipped, like
+// `lorg --incremental` does: the compiled tree is ignored when it is
+// incorrect. The benchmark fails if the result differs from the whole parse.
+void run_corruption_benchmark(Report & report, GeneratorOptions const & generator_options)
+{
+	GeneratorOptions options = generator_options;
+	options.node_count = CORRUPTED_NODE_COUNT;
+	std::string content = generate_content(options);
+	lorg::ParserOptions parser_options;
+	parser_options.build_index = true;
+	lorg::ParserResult const previous = lorg::parse(content, parser_options);
+	if(previous.has_error)
+	{
+		std::cerr << previous.error_message << std::endl;
+		exit(EXIT_CODE_ERROR_PARSE);
+	}
+	std::vector<uint64_t> const previous_node_hashes = lorg::hash_node_contents(content);
+
+	lorg::CompiledTree compiled;
+	compiled.unit_definitions = previous.unit_definitions;
+	compiled.tree = previous.tree.get_view();
+	compiled.node_hashes = previous_node_hashes.data();
+	compiled.index = previous.index.get_view();
+	std::FILE * file = std::tmpfile();
+	long compiled_size = -1;
+	if(
+		file != nullptr && lorg::write_compiled_tree(file, compiled) &&
+		std::fseek(file, 0, SEEK_END) == 0
+	)
+	{
+		compiled_size = std::ftell(file);
+	}
+	// The compiled tree is read in place, so it is aligned like a mapped
+	// file.
+	std::vector<uint64_t> compiled_words(
+		(static_cast<size_t>(std::max(compiled_size, 0L)) + sizeof(uint64_t) - 1) / sizeof(uint64_t)
+	);
+	char * const compiled_bytes = reinterpret_cast<char *>(compiled_words.data());
+	size_t const byte_count = static_cast<size_t>(std::max(compiled_size, 0L));
+	bool const is_read = (
+		compiled_size > 0 && std::fseek(file, 0, SEEK_SET) == 0 &&
+		std::fread(compiled_bytes, 1, byte_count, file) == byte_count
+	);
+	if(file != nullptr)
+	{
+		std::fclose(file);
+	}
+	if(!is_read)
+	{
+		std::cerr << "The temporary file of the compiled tree cannot be written." << std::endl;
+		exit(EXIT_CODE_ERROR_ARGUMENTS);
+	}
+
+	size_t const value_separator = content.find(": ", content.size() / 2);
+	if(value_separator == std::string::npos)
+	{
+		return;
+	}
+	size_t const value_start = value_separator + 2;
+	content.replace(value_start, content.find('\n', value_start) - value_start, "123");
+	lorg::ParserResult const expected = lorg::parse(content);
+
+	std::mt19937 generator(options.seed);
+	size_t ignored_count = 0;
+	auto const start = std::chrono::steady_clock::now();
+	for(size_t k = 0; k < CORRUPTION_COUNT; k++)
+	{
+		size_t const bit = generator() % (byte_count * 8);
+		compiled_bytes[bit / 8] = static_cast<char>(compiled_bytes[bit / 8] ^ (1 << (bit % 8)));
+
+		lorg::CompiledTree const corrupted = lorg::read_compiled_tree(
+			std::string_view(compiled_bytes, byte_count), true
+		);
+		lorg::ParserResult corrupted_previous;
+		corrupted_previous.has_error = corrupted.has_error;
+		if(!corrupted.has_error)
+		{
+			corrupted_previous.unit_definitions = corrupted.unit_definitions;
+			corrupted_previous.tree = lorg::copy_tree(corrupted.tree);
+			corrupted_previous.index = lorg::copy_tree_index(corrupted.index);
+		}
+		else
+		{
+			ignored_count++;
+		}
+		std::vector<uint64_t> node_hashes;
+		lorg::ParserResult const result = lorg::parse_incrementally(
+			content, std::move(corrupted_previous), corrupted.node_hashes, node_hashes
+		);
+		if(result.has_error || !are_trees_equal(result, expected))
+		{
+			std::cerr << "The incremental parse from a corrupted compiled tree differs from the whole parse." << std::endl;
+			exit(EXIT_CODE_ERROR_PARSE);
+		}
+		compiled_bytes[bit / 8] = static_cast<char>(compiled_bytes[bit / 8] ^ (1 << (bit % 8)));
+	}
+	double const seconds = get_elapsed_seconds(start);
+
+	// Without the hash of the content, like `lorg file.lorgb` reads it, only
+	// the checks of the layout and of the links walked stand between a
+	// corrupted tree and the printers. The bits flipped in the values and the
+	// titles are not noticed, the others must be, or the printers would read
+	// out of the tree.
+	size_t printed_count = 0;
+	auto const print_start = std::chrono::steady_clock::now();
+	for(size_t k = 0; k < CORRUPTION_COUNT; k++)
+	{
+		size_t const bit = generator() % (byte_count * 8);
+		compiled_bytes[bit / 8] = static_cast<char>(compiled_bytes[bit / 8] ^ (1 << (bit % 8)));
+
+		lorg::CompiledTree const corrupted = lorg::read_compiled_tree(
+			std::string_view(compiled_bytes, byte_count)
+		);
+		if(!corrupted.has_error)
+		{
+			printed_count += print_corrupted_tree(corrupted);
+		}
+		compiled_bytes[bit / 8] = static_cast<char>(compiled_bytes[bit / 8] ^ (1 << (bit % 8)));
+	}
+	double const print_seconds = get_elapsed_seconds(print_start);
+
+	start_benchmark(
+		report, "Corrupted compiled trees",
+		std::to_string(CORRUPTION_COUNT) + " bits flipped in the compiled tree of " +
+		std::to_string(CORRUPTED_NODE_COUNT) + " nodes, " + std::to_string(ignored_count) +
+		" ignored, then " + std::to_string(CORRUPTION_COUNT) + " more, " +
+		std::to_string(printed_count) + " prints without the content check"
+	);
+	report_measure(
+		report, "parse_incrementally", seconds / static_cast<double>(CORRUPTION_COUNT),
+		content.size(), CORRUPTED_NODE_COUNT
+	);
+	report_measure(
+		report, "read_compiled_tree and print", print_seconds / static_cast<double>(CORRUPTION_COUNT),
+		byte_count, CORRUPTED_NODE_COUNT
+	);
+}
+
+// Write a tree of `WIDE_STREAM_LEAF_COUNT` leaves to a temporary file, line by
+// line so the content is never in memory. The leaves are the nodes of level
+// 1, or the children of a single node when `has_parent` is true.
+std::FILE * write_wide_tree_or_exit(bool has_parent)
+{
+	std::FILE * file = std::tmpfile();
+	bool is_written = file != nullptr && (!has_parent || std::fputs("# Parent\n", file) >= 0);
+	char const * const leaf_definition = has_parent ? "## Leaf " : "# Leaf ";
+	for(size_t i = 0; is_written && i < WIDE_STREAM_LEAF_COUNT; i++)
+	{
+		is_written = std::fprintf(file, "%s%zu\n$ Unit: 1\n", leaf_definition, i) > 0;
+	}
+	if(!is_written || std::fseek(file, 0, SEEK_SET) != 0)
+	{
+		std::cerr << "The temporary file of the content cannot be written." << std::endl;
+		exit(EXIT_CODE_ERROR_ARGUMENTS);
+	}
+	return file;
+}
+
+// Stream wide trees, flat and under a single parent. The memory of
+// `lorg::parse_stream()` is bounded by the depth of the tree, so the peak
+// resident size must barely grow: the benchmark fails otherwise.
+void run_stream_memory_benchmark(Report & report)
+{
+	uint64_t const start_resident_size = lorg::get_peak_resident_size();
+	start_benchmark(
+		report, "Stream memory",
+		std::to_string(WIDE_STREAM_LEAF_COUNT) + " leaves, flat then under a single parent"
+	);
+	for(bool has_parent : {false, true})
+	{
+		std::FILE * file = write_wide_tree_or_exit(has_parent);
+		size_t leaf_count = 0;
+		auto const start = std::chrono::steady_clock::now();
+		lorg::ParserResult const result = lorg::parse_stream(
+			file, [](std::vector<lorg::UnitDefinition> const &){},
+			[&leaf_count](lorg::StreamedNode const & node)
+			{
+				leaf_count += node.subtree_end == node.index + 1 ? 1 : 0;
+			}
+		);
+		double const seconds = get_elapsed_seconds(start);
+		std::fclose(file);
+		if(result.has_error || leaf_count != WIDE_STREAM_LEAF_COUNT)
+		{
+			std::cerr << "The wide tree is not streamed." << std::endl;
+			exit(EXIT_CODE_ERROR_PARSE);
+		}
+		report_measure(
+			report, has_parent ? "parse_stream under a parent" : "parse_stream flat",
+			seconds, 0, WIDE_STREAM_LEAF_COUNT
+		);
+	}
+
+	// The peak resident size is unknown on some systems.
+	uint64_t const peak_resident_size = lorg::get_peak_resident_size();
+	if(start_resident_size > 0 && peak_resident_size - start_resident_size > MAX_STREAM_RESIDENT_GROWTH)
+	{
+		std::cerr << "Streaming a wide tree takes " << peak_resident_size - start_resident_size;
+		std::cerr << " more bytes of memory, more than " << MAX_STREAM_RESIDENT_GROWTH << "." << std::endl;
+		exit(EXIT_CODE_ERROR_ALLOCATIONS);
+	}
+}
+
+// The allocations made by `lorg::convert_string_to_nodes()` on `content`.
+uint64_t count_parse_allocations(std::string const & content)
+{
+	uint64_t const start = lorg::get_allocation_counts().count;
+	lorg::ParserResult const result = lorg::convert_string_to_nodes(content);
+	uint64_t const allocation_count = lorg::get_allocation_counts().count - start;
+	if(result.has_error)
+	{
+		std::cerr << result.error_message << std::endl;
+		exit(EXIT_CODE_ERROR_PARSE);
+	}
+	return allocation_count;
+}
+
+// The allocations made by `lorg::parse_stream()` on `content`, read from a
+// temporary file.
+uint64_t count_stream_allocations(std::string const & content)
+{
+	std::FILE * file = std::tmpfile();
+	if(
+		file == nullptr ||
+		std::fwrite(content.data(), 1, content.size(), file) != content.size() ||
+		std::fseek(file, 0, SEEK_SET) != 0
+	)
+	{
+		std::cerr << "The temporary file of the content cannot be written." << std::endl;
+		exit(EXIT_CODE_ERROR_ARGUMENTS);
+	}
+
+	uint64_t const start = lorg::get_allocation_counts().count;
+	lorg::ParserResult const result = lorg::parse_stream(
+		file, [](std::vector<lorg::UnitDefinition> const &){},
+		[](lorg::StreamedNode const &){}
+	);
+	uint64_t const allocation_count = lorg::get_allocation_counts().count - start;
+	std::fclose(file);
+	if(result.has_error)
+	{
+		std::cerr << result.error_message << std::endl;
+		exit(EXIT_CODE_ERROR_PARSE);
+	}
+	return allocation_count;
+}
+
+// Count the allocations of the parsers on the content, then on the same tree
+// with more comment lines. The tokenizers work on views of the lines, so they
+// should allocate nothing for a comment line and at most once for a node
+// line, the vectors of the tree growing by steps: the benchmark fails
+// otherwise.
+void run_allocation_benchmark(Report & report, GeneratorOptions const & generator_options)
+{
+	if(!lorg::ARE_STATS_ENABLED)
+	{
+		return;
+	}
+	GeneratorOptions options = generator_options;
+	options.comment_density = 0.0;
+	std::string const content = generate_content(options);
+	options.comment_density = ALLOCATION_COMMENT_DENSITY;
+	std::string const commented_content = generate_content(options);
+	size_t const comment_line_count = static_cast<size_t>(
+		std::count(commented_content.begin(), commented_content.end(), '\n') -
+		std::count(content.begin(), content.end(), '\n')
+	);
+	size_t const node_count = generator_options.node_count;
+
+	start_benchmark(
+		report, "Allocations",
+		std::to_string(node_count) + " nodes, " + std::to_string(comment_line_count) +
+		" comment lines added"
+	);
+	lorg::start_counting_allocations();
+	bool is_within_budget = true;
+	for(bool is_streamed : {false, true})
+	{
+		uint64_t (* const count_allocations)(std::string const &) = (
+			is_streamed ? count_stream_allocations : count_parse_allocations
+		);
+		uint64_t const node_allocation_count = count_allocations(content);
+		uint64_t const commented_allocation_count = count_allocations(commented_content);
+		// The vectors grow as they do without the comments.
+		uint64_t const comment_allocation_count = (
+			commented_allocation_count > node_allocation_count ?
+			commented_allocation_count - node_allocation_count : 0
+		);
+
+		std::string const parser = is_streamed ? "parse_stream" : "convert_string_to_nodes";
+		report_allocations(report, parser + " node lines", node_allocation_count, node_count);
+		report_allocations(
+			report, parser + " comment lines", comment_allocation_count, comment_line_count
+		);
+		is_within_budget = (
+			is_within_budget && node_allocation_count <= node_count &&
+			comment_allocation_count == 0
+		);
+	}
+	if(!is_within_budget)
+	{
+		std::cerr << "The parsers allocate for the comment lines, or more than once per node line." << std::endl;
+		exit(EXIT_CODE_ERROR_ALLOCATIONS);
+	}
+}
+
+// Returns true if the nodes of `root`, visited in pre-order, have the titles,
+// the units and the children of the nodes of `tree`.
+bool is_node_tree_equal(lorg::Node const * root, lorg::TreeView const & tree)
+{
+	std::vector<lorg::Node const *> stack;
+	if(root != nullptr)
+	{
+		stack.push_back(root);
+	}
+	size_t i = 0;
+	while(!stack.empty())
+	{
+		lorg::Node const * node = stack.back();
+		stack.pop_back();
+		if(i >= tree.node_count || node->title != tree.get_title(i) || node->units.size() != tree.unit_count)
+		{
+			return false;
+		}
+		for(size_t id = 0; id < tree.unit_count; id++)
+		{
+			lorg::Unit const unit = tree.get_unit(i, id);
+			lorg::Unit const & node_unit = node->units[id];
+			if(
+				node_unit.value != unit.value ||
+				node_unit.is_real != unit.is_real ||
+				node_unit.is_ignored != unit.is_ignored
+			)
+			{
+				return false;
+			}
+		}
+
+		// The children are the nodes of the next level of the subtree, in
+		// order.
+		size_t child_count = 0;
+		for(size_t child = i + 1; child < tree.subtree_ends[i]; child = tree.subtree_ends[child])
+		{
+			if(child_count >= node->children.size() || tree.parents[child] != i)
+			{
+				return false;
+			}
+			child_count++;
+		}
+		if(child_count != node->children.size())
+		{
+			return false;
+		}
+		for(auto child = node->children.rbegin(); child != node->children.rend(); child++)
+		{
+			stack.push_back(*child);
+		}
+		i++;
+	}
+	return i == tree.node_count;
+}
+
+// Create the `Node` tree of a content and check it against the arrays it is
+// created from.
+void run_node_tree_benchmark(Report & report, GeneratorOptions const & generator_options)
+{
+	std::string const content = generate_content(generator_options);
+	lorg::ParserResult result = lorg::parse(content);
+	if(result.has_error)
+	{
+		std::cerr << result.error_message << std::endl;
+		exit(EXIT_CODE_ERROR_PARSE);
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	lorg::Node const * root = lorg::create_node_tree(result);
+	double const seconds = get_elapsed_seconds(start);
+	if(!is_node_tree_equal(root, result.tree.get_view()))
+	{
+		std::cerr << "The node tree differs from the tree it is created from." << std::endl;
+		exit(EXIT_CODE_ERROR_PARSE);
+	}
+
+	start_benchmark(
+		report, "Node tree", std::to_string(generator_options.node_count) + " nodes"
+	);
+	report_measure(
+		report, "create_node_tree", seconds, content.size(), generator_options.node_count
+	);
+}
+
+// The path of the node `i`, from its ancestor of level 1.
+std::vector<std::string_view> get_node_path(lorg::TreeView const & tree, size_t i)
+{
+	std::vector<std::string_view> titles(tree.depths[i]);
+	for(size_t k = titles.size(); k > 0; k--)
+	{
+		titles[k - 1] = tree.get_title(i);
+		i = tree.parents[i];
+	}
+	return titles;
+}
+
+// Find random nodes by their path, with the index and by walking the tree as
+// `select_nodes()` does without index.
+void run_index_benchmark(Report & report, GeneratorOptions const & generator_options)
+{
+	std::string const content = generate_content(generator_options);
+	size_t const node_count = generator_options.node_count;
+	if(node_count < 2)
+	{
+		return;
+	}
+	lorg::ParserResult const result = lorg::parse(content);
+	if(result.has_error)
+	{
+		std::cerr << result.error_message << std::endl;
+		exit(EXIT_CODE_ERROR_PARSE);
+	}
+	lorg::TreeView const tree = result.tree.get_view();
+
+	auto start = std::chrono::steady_clock::now();
+	lorg::TreeIndex const index = lorg::build_tree_index(tree);
+	double const build_seconds = get_elapsed_seconds(start);
+
+	std::mt19937 generator(42);
+	std::vector<std::vector<lorg::PathPattern>> selections(INDEX_LOOKUP_COUNT);
+	for(std::vector<lorg::PathPattern> & selection : selections)
+	{
+		lorg::PathPattern pattern;
+		for(std::string_view title : get_node_path(tree, 1 + generator() % (node_count - 1)))
+		{
+			pattern.titles.emplace_back();
+			pattern.titles.back().parts.emplace_back(title);
+		}
+		selection.push_back(pattern);
+	}
+
+	size_t found_count = 0;
+	start = std::chrono::steady_clock::now();
+	for(std::vector<lorg::PathPattern> const & selection : selections)
+	{
+		found_count += lorg::select_nodes(tree, selection, index.get_view()).size();
+	}
+	double const index_seconds = get_elapsed_seconds(start);
+
+	size_t walked_found_count = 0;
+	start = std::chrono::steady_clock::now();
+	for(std::vector<lorg::PathPattern> const & selection : selections)
+	{
+		walked_found_count += lorg::select_nodes(tree, selection).size();
+	}
+	double const walk_seconds = get_elapsed_seconds(start);
+	if(found_count != walked_found_count || found_count < INDEX_LOOKUP_COUNT)
+	{
+		std::cerr << "The nodes found with the index differ." << std::endl;
+		exit(EXIT_CODE_ERROR_PARSE);
+	}
+
+	// The lookups are measured in nodes found.
+	start_benchmark(
+		report, "Index",
+		std::to_string(node_count) + " nodes, " + std::to_string(INDEX_LOOKUP_COUNT) +
+		" paths looked up"
+	);
+	report_measure(report, "build_tree_index", build_seconds, 0, node_count);
+	report_measure(report, "select_nodes with index", index_seconds, 0, found_count);
+	report_measure(report, "select_nodes without index", walk_seconds, 0, found_count);
+}
+
+typedef void (*UnitSumKernel)(
+	lorg::UnitValue *, lorg::UnitValue const *, uint64_t const *, size_t
+);
+
+// Returns the units of the parent after adding all the children. The
+// throughputs are the ones of the child values and of the children added.
+std::vector<lorg::UnitValue> run_unit_sum_kernel(
+	Report const & report, std::string const & name, UnitSumKernel kernel,
+	std::vector<lorg::UnitValue> const & child_values, std::vector<uint64_t> const & real_mask,
+	size_t unit_count, size_t addition_count
+)
+{
+	size_t const repeat_count = std::max<size_t>(
+		1, addition_count / (UNIT_SUM_CHILD_COUNT * unit_count)
+	);
+	std::vector<lorg::UnitValue> values(unit_count, 0);
+
+	auto start = std::chrono::steady_clock::now();
+	for(size_t r = 0; r < repeat_count; r++)
+	{
+		for(size_t child = 0; child < UNIT_SUM_CHILD_COUNT; child++)
+		{
+			kernel(
+				values.data(), child_values.data() + child * unit_count,
+				real_mask.data(), unit_count
+			);
+		}
+	}
+	double const seconds = get_elapsed_seconds(start);
+
+	size_t const child_count = repeat_count * UNIT_SUM_CHILD_COUNT;
+	report_measure(
+		report, name, seconds, child_count * unit_count * sizeof(lorg::UnitValue), child_count
+	);
+	return values;
+}
+
+// Measure the kernels adding the units of a child to its parent, until about
+// `addition_count` units are added. A quarter of the units of the parent are
+// real.
+void run_unit_sum_benchmark(Report & report, size_t unit_count, size_t addition_count)
+{
+	std::mt19937 generator(42);
+	std::vector<uint64_t> real_mask((unit_count + 63) / 64, 0);
+	for(size_t id = 0; id < unit_count; id++)
+	{
+		if(generator() % 4 == 0)
+		{
+			real_mask[id / 64] |= uint64_t(1) << (id % 64);
+		}
+	}
+	std::vector<lorg::UnitValue> child_values(UNIT_SUM_CHILD_COUNT * unit_count);
+	for(lorg::UnitValue & value : child_values)
+	{
+		value = static_cast<lorg::UnitValue>(generator() % 1000);
+	}
+
+	start_benchmark(
+		report, "Unit sum kernel " + std::to_string(unit_count),
+		std::to_string(UNIT_SUM_CHILD_COUNT) + " children of " + std::to_string(unit_count) +
+		" units added to their parent"
+	);
+	std::vector<lorg::UnitValue> const scalar_values = run_unit_sum_kernel(
+		report, "scalar", lorg::add_child_units_scalar<lorg::UnitValues>, child_values,
+		real_mask, unit_count, addition_count
+	);
+#if defined(LORG_UNIT_SUM_VECTOR)
+	std::vector<lorg::UnitValue> const vector_values = run_unit_sum_kernel(
+		report, "vector", lorg::add_child_units_vector<lorg::UnitValues>, child_values,
+		real_mask, unit_count, addition_count
+	);
+	if(
+		std::memcmp(
+			scalar_values.data(), vector_values.data(), unit_count * sizeof(lorg::UnitValue)
+		) != 0
+	)
+	{
+		std::cerr << "The unit sum kernels give different results." << std::endl;
+		exit(EXIT_CODE_ERROR_PARSE);
+	}
+#endif
+}
+
+// Build a calculated tree of `node_count` nodes after the total node. When
+// `is_chain` is true, each node is the child of the previous one, otherwise
+// they are all the children of the total node. The leaf units are real.
+lorg::Tree create_calculated_tree(size_t node_count, bool is_chain)
+{
+	lorg::Tree tree;
+	tree.unit_count = PRINT_UNIT_COUNT;
+	for(size_t i = 0; i <= node_count; i++)
+	{
+		tree.parents.push_back(i == 0 ? 0 : (is_chain ? i - 1 : 0));
+		tree.depths.push_back(i == 0 ? 0 : (is_chain ? i : 1));
+		tree.subtree_ends.push_back(is_chain || i == 0 ? node_count + 1 : i + 1);
+		tree.title_offsets.push_back(tree.titles.size());
+		tree.titles += "Node " + std::to_string(i);
+
+		bool const is_leaf = tree.subtree_ends[i] == i + 1;
+		for(size_t id = 0; id < PRINT_UNIT_COUNT; id++)
+		{
+			lorg::UnitValue const leaf_value = static_cast<lorg::UnitValue>(id + 1);
+			lorg::UnitValue const child_count = static_cast<lorg::UnitValue>(
+				is_chain || i > 0 ? 1 : node_count
+			);
+			tree.values.push_back(is_leaf ? leaf_value : leaf_value * child_count);
+		}
+		tree.real_masks.push_back(is_leaf ? (uint64_t(1) << PRINT_UNIT_COUNT) - 1 : 0);
+		tree.ignored_masks.push_back(0);
+	}
+	return tree;
+}
+
+// Measure the printers on the trees that used to need the most recursion: a
+// deep chain and a node with many children.
+void run_built_tree_print_benchmarks(Report & report)
+{
+	std::vector<lorg::UnitDefinition> unit_definitions(PRINT_UNIT_COUNT);
+	for(size_t id = 0; id < PRINT_UNIT_COUNT; id++)
+	{
+		unit_definitions[id].name = "Unit " + std::to_string(id);
+	}
+
+	start_benchmark(report, "Print chain", std::to_string(PRINT_CHAIN_NODE_COUNT) + " nodes");
+	lorg::Tree const chain = create_calculated_tree(PRINT_CHAIN_NODE_COUNT, true);
+	run_print_benchmarks(report, chain.get_view(), unit_definitions, true);
+
+	lorg::Tree const fan_out = create_calculated_tree(PRINT_FAN_OUT_NODE_COUNT, false);
+	start_benchmark(
+		report, "Print fan-out", std::to_string(PRINT_FAN_OUT_NODE_COUNT) + " nodes"
+	);
+	run_print_benchmarks(report, fan_out.get_view(), unit_definitions, false);
+}
+
+void print_usage()
+{
+	std::cout << "Usage: lorg-bench [OPTIONS] [NODE_COUNT]" << '\n';
+	std::cout << '\n';
+	std::cout << "Measure the steps of lorg on generated contents of NODE_COUNT nodes, ";
+	std::cout << DEFAULT_NODE_COUNT << " by default." << '\n';
+	std::cout << '\n';
+	std::cout << "Options:" << '\n';
+	std::cout << "      --depth N         Generate nodes up to the level N." << '\n';
+	std::cout << "      --fan-out N       Generate N children per node on average." << '\n';
+	std::cout << "      --units N         Define N units in each node." << '\n';
+	std::cout << "      --comments RATE   Generate RATE comment lines per node on average." << '\n';
+	std::cout << "      --crlf RATIO      End this part of the lines with \\r\\n, between 0 and 1." << '\n';
+	std::cout << "      --seed N          Generate another content for the same options." << '\n';
+	std::cout << "      --json            Write each measure as a JSON object on its own line." << '\n';
+	std::cout << "      --generate FILE   Write the generated content to FILE, or to the standard" << '\n';
+	std::cout << "                        output if FILE is -, instead of measuring." << '\n';
+	std::cout << "      --check NAME      Only run the benchmark NAME, which fails if its result is" << '\n';
+	std::cout << "                        wrong, on " << CHECK_NODE_COUNT << " nodes by default. NAME is one of";
+	for(char const * name : CHECK_NAMES)
+	{
+		std::cout << ' ' << name;
+	}
+	std::cout << '.' << '\n';
+	std::cout << "  -h, --help            Print this help." << '\n';
+	std::cout << std::flush;
+}
+
+size_t read_size_argument_or_exit(char const * option, char const * argument)
+{
+	char * end = nullptr;
+	size_t number = 0;
+	if(argument != nullptr && argument[0] >= '0' && argument[0] <= '9')
+	{
+		number = std::strtoul(argument, &end, 10);
+	}
+	if(end == nullptr || *end != '\0')
+	{
+		std::cerr << "The option \"" << option << "\" needs a number." << std::endl;
+		exit(EXIT_CODE_ERROR_ARGUMENTS);
+	}
+	return number;
+}
+
+double read_rate_argument_or_exit(char const * option, char const * argument)
+{
+	char * end = nullptr;
+	double rate = 0.0;
+	if(argument != nullptr && ((argument[0] >= '0' && argument[0] <= '9') || argument[0] == '.'))
+	{
+		rate = std::strtod(argument, &end);
+	}
+	if(end == nullptr || *end != '\0' || !(rate >= 0.0 && rate <= 1e6))
+	{
+		std::cerr << "The option \"" << option << "\" needs a positive number." << std::endl;
+		exit(EXIT_CODE_ERROR_ARGUMENTS);
+	}
+	return rate;
+}
+
+int main(int argc, char* argv[])
+{
+	GeneratorOptions generator_options;
+	Report report;
+	char const * generated_path = nullptr;
+	std::string check_name;
+	bool has_node_count = false;
+	for(int i = 1; i < argc; i++)
+	{
+		std::string const argument = argv[i];
+		char const * const next = i + 1 < argc ? argv[i + 1] : nullptr;
+		if(argument == "-h" || argument == "--help")
+		{
+			print_usage();
+			return EXIT_CODE_OK;
+		}
+		else if(argument == "--json")
+		{
+			report.to_json = true;
+			continue;
+		}
+		else if(argument == "--depth")
+		{
+			generator_options.depth = read_size_argument_or_exit(argv[i], next);
+		}
+		else if(argument == "--fan-out")
+		{
+			generator_options.fan_out = read_size_argument_or_exit(argv[i], next);
+		}
+		else if(argument == "--units")
+		{
+			generator_options.units_per_node = read_size_argument_or_exit(argv[i], next);
+		}
+		else if(argument == "--comments")
+		{
+			generator_options.comment_density = read_rate_argument_or_exit(argv[i], next);
+		}
+		else if(argument == "--crlf")
+		{
+			generator_options.crlf_ratio = read_rate_argument_or_exit(argv[i], next);
+		}
+		else if(argument == "--seed")
+		{
+			generator_options.seed = static_cast<uint32_t>(
+				read_size_argument_or_exit(argv[i], next)
+			);
+		}
+		else if(argument == "--generate")
+		{
+			if(next == nullptr)
+			{
+				std::cerr << "The option \"--generate\" needs a file." << std::endl;
+				exit(EXIT_CODE_ERROR_ARGUMENTS);
+			}
+			generated_path = next;
+		}
+		else if(argument == "--check")
+		{
+			check_name = next == nullptr ? "" : next;
+			bool const is_known = std::any_of(
+				std::begin(CHECK_NAMES), std::end(CHECK_NAMES),
+				[&check_name](char const * name) { return check_name == name; }
+			);
+			if(!is_known)
+			{
+				std::cerr << "The option \"--check\" needs the name of a check." << std::endl;
+				exit(EXIT_CODE_ERROR_ARGUMENTS);
+			}
+		}
+		else if(!has_node_count && !argument.empty() && argument[0] != '-')
+		{
+			generator_options.node_count = read_size_argument_or_exit("NODE_COUNT", argv[i]);
+			has_node_count = true;
+			continue;
+		}
+		else
+		{
+			print_usage();
+			exit(EXIT_CODE_ERROR_ARGUMENTS);
+		}
+		// The option and its argument are read.
+		i++;
+	}
+	if(generator_options.depth == 0 || generator_options.fan_out == 0)
+	{
+		std::cerr << "The depth and the fan-out must be at least 1." << std::endl;
+		exit(EXIT_CODE_ERROR_ARGUMENTS);
+	}
+	if(generator_options.crlf_ratio > 1.0)
+	{
+		std::cerr << "The option \"--crlf\" needs a number between 0 and 1." << std::endl;
+		exit(EXIT_CODE_ERROR_ARGUMENTS);
+	}
+
+	if(generated_path != nullptr)
+	{
+		std::string const content = generate_content(generator_options);
+		bool const is_stdout = std::string(generated_path) == "-";
+		std::FILE * file = is_stdout ? stdout : open_file_or_exit(generated_path, "wb");
+		bool const is_written = (
+			std::fwrite(content.data(), 1, content.size(), file) == content.size() &&
+			std::fflush(file) == 0
+		);
+		if(!is_stdout)
+		{
+			std::fclose(file);
+		}
+		if(!is_written)
+		{
+			std::cerr << "\"" << generated_path << "\" cannot be written." << std::endl;
+			exit(EXIT_CODE_ERROR_ARGUMENTS);
+		}
+		return EXIT_CODE_OK;
+	}
+
+	if(!check_name.empty())
+	{
+		if(!has_node_count)
+		{
+			generator_options.node_count = CHECK_NODE_COUNT;
+		}
+		if(check_name == "batch")
+		{
+			run_batch_benchmark(report, generator_options);
+		}
+		else if(check_name == "incremental")
+		{
+			run_incremental_benchmark(report, generator_options);
+		}
+		else if(check_name == "corruption")
+		{
+			run_corruption_benchmark(report, generator_options);
+		}
+		else if(check_name == "allocations")
+		{
+			run_allocation_benchmark(report, generator_options);
+		}
+		else if(check_name == "index")
+		{
+			run_index_benchmark(report, generator_options);
+		}
+		else if(check_name == "node-tree")
+		{
+			run_node_tree_benchmark(report, generator_options);
+		}
+		else if(check_name == "stream-memory")
+		{
+			run_stream_memory_benchmark(report);
+		}
+		else
+		{
+			for(size_t unit_count : {8, 64, 512})
+			{
+				run_unit_sum_benchmark(report, unit_count, CHECK_UNIT_SUM_ADDITION_COUNT);
+			}
+		}
+		return EXIT_CODE_OK;
+	}
+
+	run_benchmark(report, "Random tree", generator_options);
+	GeneratorOptions chain_options = generator_options;
+	chain_options.node_count = CHAIN_NODE_COUNT;
+	chain_options.depth = CHAIN_NODE_COUNT;
+	chain_options.fan_out = 1;
+	run_benchmark(report, "Chain", chain_options);
+	run_batch_benchmark(report, generator_options);
+	run_incremental_benchmark(report, generator_options);
+	run_corruption_benchmark(report, generator_options);
+	run_allocation_benchmark(report, generator_options);
+	run_index_benchmark(report, generator_options);
+	run_node_tree_benchmark(report, generator_options);
+	for(size_t unit_count : {8, 64, 512})
+	{
+		run_unit_sum_benchmark(report, unit_count, UNIT_SUM_ADDITION_COUNT);
+	}
+	run_built_tree_print_benchmarks(report);
+
+	return EXIT_CODE_OK;
+}
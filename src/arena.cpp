@@ -0,0 +1,73 @@
+#include "arena.hpp"
+
+#include <utility>
+
+using namespace lorg;
+
+// Most of the allocations are much smaller than a block. The bigger ones get
+// their own block so they do not waste the end of the current one.
+constexpr size_t ARENA_BLOCK_SIZE = 1 << 20;
+constexpr size_t MAX_SHARED_ALLOCATION_SIZE = ARENA_BLOCK_SIZE / 4;
+
+Arena::Arena() noexcept:
+	current(nullptr),
+	remaining_size(0)
+{
+}
+
+Arena::Arena(Arena && other) noexcept:
+	blocks(std::move(other.blocks)),
+	current(std::exchange(other.current, nullptr)),
+	remaining_size(std::exchange(other.remaining_size, 0))
+{
+	other.blocks.clear();
+}
+
+Arena & Arena::operator=(Arena && other) noexcept
+{
+	if(this != &other)
+	{
+		blocks = std::move(other.blocks);
+		other.blocks.clear();
+		current = std::exchange(other.current, nullptr);
+		remaining_size = std::exchange(other.remaining_size, 0);
+	}
+	return *this;
+}
+
+void * Arena::allocate(size_t allocation_size, size_t alignment)
+{
+	if(allocation_size == 0)
+	{
+		allocation_size = 1;
+	}
+
+	// The blocks are aligned for any fundamental type.
+	if(allocation_size > MAX_SHARED_ALLOCATION_SIZE)
+	{
+		blocks.push_back(std::unique_ptr<char[]>(new char[allocation_size]));
+		return blocks.back().get();
+	}
+
+	void * p = current;
+	if(std::align(alignment, allocation_size, p, remaining_size) == nullptr)
+	{
+		blocks.push_back(std::unique_ptr<char[]>(new char[ARENA_BLOCK_SIZE]));
+		p = blocks.back().get();
+		remaining_size = ARENA_BLOCK_SIZE;
+	}
+	current = static_cast<char *>(p) + allocation_size;
+	remaining_size -= allocation_size;
+	return p;
+}
+
+std::string_view Arena::copy(std::string_view str)
+{
+	if(str.empty())
+	{
+		return std::string_view();
+	}
+	char * copied = allocate_array<char>(str.size());
+	std::memcpy(copied, str.data(), str.size());
+	return std::string_view(copied, str.size());
+}
@@ -0,0 +1,154 @@
+#ifndef LORG_ARENA_HPP
+#define LORG_ARENA_HPP
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace lorg
+{
+
+// Allocate memory by moving forward into large blocks. Nothing is released
+// before the arena is destroyed, and then everything is released at once.
+//
+// The destructors of the objects created in the arena are never called, so
+// they must not own anything outside the arena.
+class Arena
+{
+public:
+	Arena() noexcept;
+	Arena(Arena && other) noexcept;
+	Arena & operator=(Arena && other) noexcept;
+
+	Arena(Arena const &) = delete;
+	Arena & operator=(Arena const &) = delete;
+
+	void * allocate(size_t size, size_t alignment);
+
+	// The items are not initialized.
+	template<typename T>
+	T * allocate_array(size_t count)
+	{
+		static_assert(std::is_trivially_destructible_v<T>);
+		return static_cast<T *>(allocate(count * sizeof(T), alignof(T)));
+	}
+
+	template<typename T>
+	T * create()
+	{
+		static_assert(std::is_trivially_destructible_v<T>);
+		return new(allocate(sizeof(T), alignof(T))) T();
+	}
+
+	std::string_view copy(std::string_view str);
+
+private:
+	std::vector<std::unique_ptr<char[]>> blocks;
+
+	// The free part of the current block.
+	char * current;
+	size_t remaining_size;
+};
+
+// A vector whose items are in an arena. Growing it leaves the previous items
+// in the arena until the arena is released, and it is never shrunk.
+template<typename T>
+class ArenaVector
+{
+	static_assert(std::is_trivially_copyable_v<T>);
+	static_assert(std::is_trivially_destructible_v<T>);
+
+public:
+	using value_type = T;
+	using iterator = T *;
+	using const_iterator = T const *;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+	size_t size() const noexcept { return item_count; }
+	bool empty() const noexcept { return item_count == 0; }
+
+	T * data() noexcept { return items; }
+	T const * data() const noexcept { return items; }
+
+	T & operator[](size_t i) noexcept { return items[i]; }
+	T const & operator[](size_t i) const noexcept { return items[i]; }
+
+	T & back() noexcept { return items[item_count - 1]; }
+	T const & back() const noexcept { return items[item_count - 1]; }
+
+	iterator begin() noexcept { return items; }
+	iterator end() noexcept { return items + item_count; }
+	const_iterator begin() const noexcept { return items; }
+	const_iterator end() const noexcept { return items + item_count; }
+	const_iterator cbegin() const noexcept { return items; }
+	const_iterator cend() const noexcept { return items + item_count; }
+
+	reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+	reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+	const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator(end()); }
+	const_reverse_iterator rend() const noexcept { return const_reverse_iterator(begin()); }
+	const_reverse_iterator crbegin() const noexcept { return rbegin(); }
+	const_reverse_iterator crend() const noexcept { return rend(); }
+
+	void reserve(Arena & arena, size_t new_capacity)
+	{
+		if(new_capacity <= capacity)
+		{
+			return;
+		}
+		T * new_items = arena.allocate_array<T>(new_capacity);
+		if(item_count > 0)
+		{
+			std::memcpy(new_items, items, item_count * sizeof(T));
+		}
+		items = new_items;
+		capacity = new_capacity;
+	}
+
+	void push_back(Arena & arena, T const & value)
+	{
+		if(item_count == capacity)
+		{
+			reserve(arena, capacity == 0 ? 4 : 2 * capacity);
+		}
+		items[item_count] = value;
+		item_count++;
+	}
+
+	// The new items are set to `value`.
+	void resize(Arena & arena, size_t new_size, T const & value)
+	{
+		if(new_size > capacity)
+		{
+			reserve(arena, std::max(new_size, 2 * capacity));
+		}
+		for(size_t i = item_count; i < new_size; i++)
+		{
+			items[i] = value;
+		}
+		item_count = new_size;
+	}
+
+	// Use the `new_size` items at `new_items`, which must be in the arena.
+	// Nothing is copied.
+	void assign(T * new_items, size_t new_size) noexcept
+	{
+		items = new_items;
+		item_count = new_size;
+		capacity = new_size;
+	}
+
+private:
+	T * items = nullptr;
+	size_t item_count = 0;
+	size_t capacity = 0;
+};
+}
+
+#endif
@@ -0,0 +1,439 @@
+#include "compiled.hpp"
+
+#include <cstring>
+
+using namespace lorg;
+
+constexpr char COMPILED_MAGIC[8] = {'L', 'O', 'R', 'G', 'B', '\r', '\n', '\x1a'};
+
+// Written as it is, so a file from a machine of another byte order does not
+// read back the same.
+constexpr uint32_t COMPILED_BYTE_ORDER_MARK = 0x01020304;
+
+// The sections are aligned so the arrays can be used in place.
+constexpr size_t COMPILED_SECTION_ALIGNMENT = 8;
+
+enum CompiledSectionId
+{
+	SECTION_SOURCE_NAME,
+	SECTION_PARENTS,
+	SECTION_SUBTREE_ENDS,
+	SECTION_DEPTHS,
+	SECTION_TITLE_OFFSETS,
+	SECTION_TITLES,
+	// The unit name `id` ends where the unit name `id + 1` starts, so there
+	// is one more offset than units.
+	SECTION_UNIT_NAME_OFFSETS,
+	SECTION_UNIT_NAMES,
+	SECTION_VALUES,
+	SECTION_REAL_MASKS,
+	SECTION_IGNORED_MASKS,
+	// Either empty or one hash per node.
+	SECTION_NODE_HASHES,
+	// The arrays of the index, all empty or all of the sizes they have in
+	// `TreeIndex`. The path slot count is the one for the node count.
+	SECTION_PATH_HASHES,
+	SECTION_PATH_NODES,
+	SECTION_TITLE_NODES,
+	COMPILED_SECTION_COUNT
+};
+
+struct CompiledSection
+{
+	// From the start of the file, in bytes.
+	uint64_t offset;
+	uint64_t size;
+};
+
+struct CompiledHeader
+{
+	char magic[sizeof(COMPILED_MAGIC)];
+	uint32_t version;
+	uint32_t byte_order_mark;
+
+	uint64_t source_size;
+	int64_t source_modification_time;
+
+	uint64_t node_count;
+	uint64_t unit_count;
+	// The backend of the unit values, see `UnitValues::TYPE`.
+	uint64_t unit_value_type;
+	// See `hash_sections()`.
+	uint64_t content_hash;
+
+	CompiledSection sections[COMPILED_SECTION_COUNT];
+};
+
+static_assert(sizeof(CompiledHeader) % COMPILED_SECTION_ALIGNMENT == 0);
+
+// The data of a section before it is written.
+struct SectionData
+{
+	void const * data;
+	size_t size;
+};
+
+std::string lorg::get_error_message_compiled_tree_incorrect()
+{
+	return "The compiled tree is incorrect, compile it again.";
+}
+
+CompiledTree create_CompiledTree_error(std::string error_message)
+{
+	CompiledTree compiled;
+	compiled.has_error = true;
+	compiled.error_message = error_message;
+	return compiled;
+}
+
+// The hash of the contents of the sections, which tells a compiled tree
+// changed since it was written.
+uint64_t hash_sections(std::string_view const * sections)
+{
+	uint64_t section_hashes[COMPILED_SECTION_COUNT];
+	for(size_t k = 0; k < COMPILED_SECTION_COUNT; k++)
+	{
+		section_hashes[k] = hash_bytes(sections[k]);
+	}
+	return hash_bytes(std::string_view(
+		reinterpret_cast<char const *>(section_hashes), sizeof(section_hashes)
+	));
+}
+
+bool lorg::write_compiled_tree(std::FILE * file, CompiledTree const & compiled)
+{
+	// The offsets are written as 64 bits integers, which are read back in
+	// place as `size_t`.
+	if(sizeof(size_t) != sizeof(uint64_t))
+	{
+		return false;
+	}
+
+	TreeView const & tree = compiled.tree;
+	size_t const node_count = tree.node_count;
+	size_t const mask_size = node_count * tree.get_mask_word_count() * sizeof(uint64_t);
+
+	std::vector<size_t> unit_name_offsets;
+	std::string unit_names;
+	for(UnitDefinition const & unit_definition : compiled.unit_definitions)
+	{
+		unit_name_offsets.push_back(unit_names.size());
+		unit_names += unit_definition.name;
+	}
+	unit_name_offsets.push_back(unit_names.size());
+
+	SectionData sections[COMPILED_SECTION_COUNT];
+	sections[SECTION_SOURCE_NAME] = {compiled.source.name.data(), compiled.source.name.size()};
+	sections[SECTION_PARENTS] = {tree.parents, node_count * sizeof(size_t)};
+	sections[SECTION_SUBTREE_ENDS] = {tree.subtree_ends, node_count * sizeof(size_t)};
+	sections[SECTION_DEPTHS] = {tree.depths, node_count * sizeof(size_t)};
+	sections[SECTION_TITLE_OFFSETS] = {tree.title_offsets, node_count * sizeof(size_t)};
+	sections[SECTION_TITLES] = {tree.titles.data(), tree.titles.size()};
+	sections[SECTION_UNIT_NAME_OFFSETS] = {
+		unit_name_offsets.data(), unit_name_offsets.size() * sizeof(size_t)
+	};
+	sections[SECTION_UNIT_NAMES] = {unit_names.data(), unit_names.size()};
+	sections[SECTION_VALUES] = {tree.values, node_count * tree.unit_count * sizeof(UnitValue)};
+	sections[SECTION_REAL_MASKS] = {tree.real_masks, mask_size};
+	sections[SECTION_IGNORED_MASKS] = {tree.ignored_masks, mask_size};
+	sections[SECTION_NODE_HASHES] = {
+		compiled.node_hashes,
+		compiled.node_hashes == nullptr ? 0 : node_count * sizeof(uint64_t)
+	};
+	TreeIndexView const & index = compiled.index;
+	bool const has_index = index.node_count == node_count;
+	sections[SECTION_PATH_HASHES] = {
+		index.path_hashes, has_index ? index.path_slot_count * sizeof(uint64_t) : 0
+	};
+	sections[SECTION_PATH_NODES] = {
+		index.path_nodes, has_index ? index.path_slot_count * sizeof(size_t) : 0
+	};
+	sections[SECTION_TITLE_NODES] = {
+		index.title_nodes, has_index ? (node_count - 1) * sizeof(size_t) : 0
+	};
+
+	CompiledHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, COMPILED_MAGIC, sizeof(COMPILED_MAGIC));
+	header.version = COMPILED_FORMAT_VERSION;
+	header.byte_order_mark = COMPILED_BYTE_ORDER_MARK;
+	header.source_size = compiled.source.size;
+	header.source_modification_time = compiled.source.modification_time;
+	header.node_count = node_count;
+	header.unit_count = tree.unit_count;
+	header.unit_value_type = UnitValues::TYPE;
+	std::string_view section_contents[COMPILED_SECTION_COUNT];
+	for(size_t k = 0; k < COMPILED_SECTION_COUNT; k++)
+	{
+		section_contents[k] = std::string_view(
+			static_cast<char const *>(sections[k].data), sections[k].size
+		);
+	}
+	header.content_hash = hash_sections(section_contents);
+	uint64_t offset = sizeof(header);
+	for(size_t k = 0; k < COMPILED_SECTION_COUNT; k++)
+	{
+		header.sections[k].offset = offset;
+		header.sections[k].size = sections[k].size;
+		offset += sections[k].size;
+		offset += (COMPILED_SECTION_ALIGNMENT - offset % COMPILED_SECTION_ALIGNMENT) % COMPILED_SECTION_ALIGNMENT;
+	}
+
+	if(std::fwrite(&header, sizeof(header), 1, file) != 1)
+	{
+		return false;
+	}
+	char const padding[COMPILED_SECTION_ALIGNMENT] = {};
+	for(size_t k = 0; k < COMPILED_SECTION_COUNT; k++)
+	{
+		size_t const size = sections[k].size;
+		size_t const padding_size = (
+			(COMPILED_SECTION_ALIGNMENT - size % COMPILED_SECTION_ALIGNMENT) % COMPILED_SECTION_ALIGNMENT
+		);
+		if(
+			(size > 0 && std::fwrite(sections[k].data, 1, size, file) != size) ||
+			std::fwrite(padding, 1, padding_size, file) != padding_size
+		)
+		{
+			return false;
+		}
+	}
+	return std::fflush(file) == 0;
+}
+
+bool lorg::is_compiled_tree(std::string_view content) noexcept
+{
+	return (
+		content.size() >= sizeof(COMPILED_MAGIC) &&
+		std::memcmp(content.data(), COMPILED_MAGIC, sizeof(COMPILED_MAGIC)) == 0
+	);
+}
+
+// Set `section` to the section `id` of the content. Returns false if it is
+// not in the content, or if its size is not `expected_size` when it is not
+// `npos`.
+bool get_section(
+	std::string_view content, CompiledHeader const & header, CompiledSectionId id,
+	size_t expected_size, std::string_view & section
+)
+{
+	CompiledSection const & location = header.sections[id];
+	if(
+		location.offset % COMPILED_SECTION_ALIGNMENT != 0 ||
+		location.offset > content.size() ||
+		location.size > content.size() - location.offset ||
+		(expected_size != std::string_view::npos && location.size != expected_size)
+	)
+	{
+		return false;
+	}
+	section = content.substr(
+		static_cast<size_t>(location.offset), static_cast<size_t>(location.size)
+	);
+	return true;
+}
+
+template<typename T>
+T const * get_section_array(std::string_view section)
+{
+	return reinterpret_cast<T const *>(section.data());
+}
+
+// Whether the nodes of the index are nodes of the tree, and whether each node
+// is in one slot of the path table, which leaves empty slots so finding a path
+// stops.
+bool is_tree_index_correct(TreeIndexView const & index)
+{
+	size_t used_slot_count = 0;
+	for(size_t slot = 0; slot < index.path_slot_count; slot++)
+	{
+		if(index.path_nodes[slot] != NO_NODE)
+		{
+			if(index.path_nodes[slot] >= index.node_count)
+			{
+				return false;
+			}
+			used_slot_count++;
+		}
+	}
+	if(used_slot_count != index.node_count)
+	{
+		return false;
+	}
+	for(size_t k = 0; k + 1 < index.node_count; k++)
+	{
+		if(index.title_nodes[k] == 0 || index.title_nodes[k] >= index.node_count)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool lorg::is_compiled_tree_correct(CompiledTree const & compiled)
+{
+	TreeView const & tree = compiled.tree;
+	return (
+		tree.parents[0] == 0 &&
+		tree.subtree_ends[0] == tree.node_count &&
+		tree.depths[0] == 0 &&
+		is_subtree_correct(tree, 0) &&
+		is_tree_index_correct(compiled.index)
+	);
+}
+
+CompiledTree lorg::read_compiled_tree(std::string_view content, bool check_content)
+{
+	if(sizeof(size_t) != sizeof(uint64_t))
+	{
+		return create_CompiledTree_error(
+			"The compiled trees cannot be read on this machine."
+		);
+	}
+
+	CompiledHeader header;
+	if(
+		!is_compiled_tree(content) ||
+		content.size() < sizeof(header) ||
+		reinterpret_cast<uintptr_t>(content.data()) % COMPILED_SECTION_ALIGNMENT != 0
+	)
+	{
+		return create_CompiledTree_error(get_error_message_compiled_tree_incorrect());
+	}
+	std::memcpy(&header, content.data(), sizeof(header));
+	if(
+		header.version != COMPILED_FORMAT_VERSION ||
+		header.byte_order_mark != COMPILED_BYTE_ORDER_MARK
+	)
+	{
+		return create_CompiledTree_error(
+			"The compiled tree comes from another version of lorg or another "
+			"machine, compile it again."
+		);
+	}
+	if(header.unit_value_type != UnitValues::TYPE)
+	{
+		return create_CompiledTree_error(
+			"The compiled tree comes from a lorg storing the unit values "
+			"differently, compile it again."
+		);
+	}
+
+	// The offsets and the values of all the nodes are in the content, so the
+	// sizes calculated from the counts cannot overflow.
+	if(
+		header.node_count == 0 ||
+		header.node_count > content.size() / sizeof(size_t) ||
+		header.unit_count > content.size() ||
+		(
+			header.unit_count > 0 &&
+			header.node_count > content.size() / (header.unit_count * sizeof(UnitValue))
+		)
+	)
+	{
+		return create_CompiledTree_error(get_error_message_compiled_tree_incorrect());
+	}
+	size_t const node_count = static_cast<size_t>(header.node_count);
+	size_t const unit_count = static_cast<size_t>(header.unit_count);
+	size_t const mask_size = node_count * ((unit_count + 63) / 64) * sizeof(uint64_t);
+	size_t const npos = std::string_view::npos;
+
+	size_t const offsets_size = node_count * sizeof(size_t);
+	size_t const path_slot_count = get_path_slot_count(node_count);
+	std::string_view sections[COMPILED_SECTION_COUNT];
+	bool const is_correct = (
+		get_section(content, header, SECTION_SOURCE_NAME, npos, sections[SECTION_SOURCE_NAME]) &&
+		get_section(content, header, SECTION_PARENTS, offsets_size, sections[SECTION_PARENTS]) &&
+		get_section(content, header, SECTION_SUBTREE_ENDS, offsets_size, sections[SECTION_SUBTREE_ENDS]) &&
+		get_section(content, header, SECTION_DEPTHS, offsets_size, sections[SECTION_DEPTHS]) &&
+		get_section(content, header, SECTION_TITLE_OFFSETS, offsets_size, sections[SECTION_TITLE_OFFSETS]) &&
+		get_section(content, header, SECTION_TITLES, npos, sections[SECTION_TITLES]) &&
+		get_section(
+			content, header, SECTION_UNIT_NAME_OFFSETS, (unit_count + 1) * sizeof(size_t),
+			sections[SECTION_UNIT_NAME_OFFSETS]
+		) &&
+		get_section(content, header, SECTION_UNIT_NAMES, npos, sections[SECTION_UNIT_NAMES]) &&
+		get_section(
+			content, header, SECTION_VALUES, node_count * unit_count * sizeof(UnitValue),
+			sections[SECTION_VALUES]
+		) &&
+		get_section(content, header, SECTION_REAL_MASKS, mask_size, sections[SECTION_REAL_MASKS]) &&
+		get_section(content, header, SECTION_IGNORED_MASKS, mask_size, sections[SECTION_IGNORED_MASKS]) &&
+		get_section(content, header, SECTION_NODE_HASHES, npos, sections[SECTION_NODE_HASHES]) &&
+		(
+			sections[SECTION_NODE_HASHES].empty() ||
+			sections[SECTION_NODE_HASHES].size() == node_count * sizeof(uint64_t)
+		) &&
+		get_section(content, header, SECTION_PATH_HASHES, npos, sections[SECTION_PATH_HASHES]) &&
+		get_section(content, header, SECTION_PATH_NODES, npos, sections[SECTION_PATH_NODES]) &&
+		get_section(content, header, SECTION_TITLE_NODES, npos, sections[SECTION_TITLE_NODES]) &&
+		(
+			(
+				sections[SECTION_PATH_HASHES].empty() &&
+				sections[SECTION_PATH_NODES].empty() &&
+				sections[SECTION_TITLE_NODES].empty()
+			) ||
+			(
+				sections[SECTION_PATH_HASHES].size() == path_slot_count * sizeof(uint64_t) &&
+				sections[SECTION_PATH_NODES].size() == path_slot_count * sizeof(size_t) &&
+				sections[SECTION_TITLE_NODES].size() == offsets_size - sizeof(size_t)
+			)
+		)
+	);
+	if(!is_correct || (check_content && hash_sections(sections) != header.content_hash))
+	{
+		return create_CompiledTree_error(get_error_message_compiled_tree_incorrect());
+	}
+
+	CompiledTree compiled;
+	compiled.source.name = sections[SECTION_SOURCE_NAME];
+	compiled.source.size = header.source_size;
+	compiled.source.modification_time = header.source_modification_time;
+
+	std::string_view const unit_names = sections[SECTION_UNIT_NAMES];
+	size_t const * unit_name_offsets = get_section_array<size_t>(
+		sections[SECTION_UNIT_NAME_OFFSETS]
+	);
+	for(size_t id = 0; id < unit_count; id++)
+	{
+		size_t const start = unit_name_offsets[id];
+		size_t const end = unit_name_offsets[id + 1];
+		if(start > end || end > unit_names.size())
+		{
+			return create_CompiledTree_error(get_error_message_compiled_tree_incorrect());
+		}
+		UnitDefinition unit_definition;
+		unit_definition.name = unit_names.substr(start, end - start);
+		compiled.unit_definitions.push_back(unit_definition);
+	}
+
+	TreeView & tree = compiled.tree;
+	tree.node_count = node_count;
+	tree.parents = get_section_array<size_t>(sections[SECTION_PARENTS]);
+	tree.subtree_ends = get_section_array<size_t>(sections[SECTION_SUBTREE_ENDS]);
+	tree.depths = get_section_array<size_t>(sections[SECTION_DEPTHS]);
+	tree.titles = sections[SECTION_TITLES];
+	tree.title_offsets = get_section_array<size_t>(sections[SECTION_TITLE_OFFSETS]);
+	tree.unit_count = unit_count;
+	tree.values = get_section_array<UnitValue>(sections[SECTION_VALUES]);
+	tree.real_masks = get_section_array<uint64_t>(sections[SECTION_REAL_MASKS]);
+	tree.ignored_masks = get_section_array<uint64_t>(sections[SECTION_IGNORED_MASKS]);
+	if(!sections[SECTION_NODE_HASHES].empty())
+	{
+		compiled.node_hashes = get_section_array<uint64_t>(sections[SECTION_NODE_HASHES]);
+	}
+	if(!sections[SECTION_PATH_HASHES].empty())
+	{
+		TreeIndexView & index = compiled.index;
+		index.node_count = node_count;
+		index.path_slot_count = path_slot_count;
+		index.path_hashes = get_section_array<uint64_t>(sections[SECTION_PATH_HASHES]);
+		index.path_nodes = get_section_array<size_t>(sections[SECTION_PATH_NODES]);
+		index.title_nodes = get_section_array<size_t>(sections[SECTION_TITLE_NODES]);
+	}
+	if(check_content && !is_compiled_tree_correct(compiled))
+	{
+		return create_CompiledTree_error(get_error_message_compiled_tree_incorrect());
+	}
+	return compiled;
+}
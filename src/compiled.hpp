@@ -0,0 +1,81 @@
+#ifndef LORG_COMPILED_HPP
+#define LORG_COMPILED_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "lorg.hpp"
+
+namespace lorg
+{
+
+// A compiled tree is a calculated tree written as it is in memory, so it can
+// be read back without parsing nor copying. The format changes with its
+// version, and the files are only read on machines with the same byte order
+// and sizes as the one that wrote them, and by a lorg storing the unit values
+// like it.
+constexpr uint32_t COMPILED_FORMAT_VERSION = 5;
+
+// The content a compiled tree is built from. The compiled tree must be built
+// again when the size or the modification time of its source changes.
+struct CompiledSource
+{
+	// The file name of the source, in the directory of the compiled tree.
+	std::string name;
+	uint64_t size = 0;
+	// In nanoseconds since the epoch.
+	int64_t modification_time = 0;
+};
+
+struct CompiledTree
+{
+	bool has_error = false;
+	std::string error_message;
+
+	CompiledSource source;
+	std::vector<UnitDefinition> unit_definitions;
+
+	// When the compiled tree is read, the tree refers to the content it is
+	// read from.
+	TreeView tree;
+
+	// The hashes of the node contents of the source, see
+	// `hash_node_contents()`, or null if the compiled tree has none. They let
+	// the source be parsed again incrementally.
+	uint64_t const * node_hashes = nullptr;
+
+	// The index of the tree, empty if the compiled tree has none.
+	TreeIndexView index;
+};
+
+// Returns false if the file cannot be written.
+bool write_compiled_tree(std::FILE * file, CompiledTree const & compiled);
+
+// Whether the content starts like a compiled tree. It can still be incorrect.
+bool is_compiled_tree(std::string_view content) noexcept;
+
+std::string get_error_message_compiled_tree_incorrect();
+
+// Read the compiled tree in place. The content must be aligned on 8 bytes, like
+// a file mapped in memory, and must live as long as the tree. Only the layout
+// is checked, so reading stays fast however big the tree is: the links between
+// the nodes must be checked before they are walked, with
+// `is_compiled_tree_correct()`, `is_subtree_correct()` or
+// `select_nodes_checked()`.
+//
+// With `check_content`, the hash of the whole content and all the links are
+// checked too, so the tree is known to be the one written. It reads all the
+// content, even the parts the tree would not use.
+CompiledTree read_compiled_tree(std::string_view content, bool check_content = false);
+
+// Whether the nodes of the tree link to each other like the nodes of a tree in
+// pre-order, and the nodes of the index are nodes of the tree in a path table
+// with empty slots, so the whole tree and its index can be walked. It reads all
+// the links, not the values nor the titles.
+bool is_compiled_tree_correct(CompiledTree const & compiled);
+}
+
+#endif
@@ -1,132 +1,77 @@
 #include "lorg.hpp"
+#include "thread_pool.hpp"
+#include "unit_sum.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <bitset>
 #include <cassert>
-#include <iostream>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
 #include <memory>
-#include <set>
-#include <stack>
+#include <numeric>
+#include <optional>
+#include <utility>
 
-using namespace lorg;
-
-bool is_char_in_vector(char const & c, std::vector<char> const & v);
-
-// Streams to a given string, and keeps the column and the line position
-// synchronized with the current character the stream is currently pointing to.
-//
-// NOTE(nales, 2023-01-06): Some characters are completely ignored by Lorg so we skip them here.
-struct StringStream
-{
-	// The line of the last character returned by `get()`.
-	int line;
-
-	// The column of the last character returned by `get()`.
-	int column;
+// Define `LORG_NO_SIMD` to use the portable scanner.
+#if defined(LORG_NO_SIMD)
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define LORG_SCANNER_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LORG_SCANNER_SSE2 1
+#endif
 
-	// The line of the character returned by `peek()`.
-	int peek_line;
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
-	// The column of the character returned by `peek()`.
-	int peek_column;
-
-	// The current look up character index in the string.
-	size_t index;
+#if defined(__unix__) || (defined (__APPLE__) && defined (__MACH__))
+#define IS_POSIX 1
+#else
+#define IS_POSIX 0
+#endif
 
-	std::string const & s;
+#if IS_POSIX
+// Needed to seek beyond 2 GiB in the temporary files where `long` is 32 bits.
+#include <sys/types.h>
+#endif
 
-	StringStream(std::string const & string_reference):
-		line(0),
-		column(0),
-		peek_line(1),
-		peek_column(1),
-		index(0),
-		s(string_reference)
-	{
-		if(s.empty())
-		{
-			peek_line = 0;
-			peek_column = 0;
-			return;
-		}
-		while(
-			index < s.size() &&
-			is_char_in_vector(s[index], IGNORED_CHARACTERS)
-		)
-		{
-			index++;
-			peek_column++;
-		}
-		if(!eof())
-		{
-			if(s[index] == '\n')
-			{
-				peek_line++;
-				peek_column = 0;
-			}
-		}
-	}
+using namespace lorg;
 
-	bool eof() noexcept
-	{
-		return index >= s.size();
-	}
+// The content is scanned by blocks of this size to find the lines that need
+// to be parsed. It matches the number of bits of a mask.
+constexpr size_t SCAN_BLOCK_SIZE = 64;
 
-	char get() noexcept
-	{
-		if(eof())
-		{
-			return '\0';
-		}
-		char c = s[index];
-		line = peek_line;
-		column = peek_column;
+// Below this size, a chunk is not worth a thread.
+constexpr size_t MIN_CHUNK_SIZE = 1 << 20;
 
-		index++;
-		peek_column++;
+// The number of nodes to update below which a subtree is not worth a task.
+constexpr size_t UPDATE_TASK_SIZE = 1 << 12;
 
-		while(
-			index < s.size() &&
-			is_char_in_vector(s[index], IGNORED_CHARACTERS)
-		)
-		{
-			index++;
-			peek_column++;
-		}
+constexpr std::string_view TOTAL_NODE_TITLE = "TOTAL";
 
-		if(!eof())
-		{
-			if(s[index] == '\n')
-			{
-				peek_line++;
-				peek_column = 0;
-			}
-		}
-		return c;
-	}
+// The size of the blocks read at once by `parse_stream()`.
+constexpr size_t STREAM_BLOCK_SIZE = 1 << 20;
 
-	char peek() noexcept
-	{
-		if(eof())
-		{
-			return '\0';
-		}
-		else
-		{
-			return s[index];
-		}
-	}
-};
+// The most offsets of records `parse_stream()` keeps before writing them, so
+// the offsets of a wide tree take a block of memory, not one per node.
+constexpr size_t MAX_PENDING_OFFSET_COUNT = STREAM_BLOCK_SIZE / sizeof(uint64_t);
 
-struct ConvertStringToNodesResult
+inline bool is_whitespace(char const & c)
 {
-	ParserResult parser_result;
-	std::set<std::string> existing_units;
-};
+	return c == ' ' || c == '\t';
+}
 
-bool is_char_in_vector(char const & c, std::vector<char> const & v)
+inline bool is_ignored_character(char const & c)
 {
-	for(char const & v_c : v)
+	for(char const & ignored_character : IGNORED_CHARACTERS)
 	{
-		if(c == v_c)
+		if(c == ignored_character)
 		{
 			return true;
 		}
@@ -134,163 +79,170 @@ bool is_char_in_vector(char const & c, std::vector<char> const & v)
 	return false;
 }
 
-inline bool is_whitespace(char const & c)
+// A line is a node or a unit definition only if its first character, after
+// the white spaces and the ignored characters, is one of those.
+inline bool is_line_head(char const & c)
 {
-	return c == ' ' || c == '\t';
+	return (
+		c == NODE_DEFINITION_CHARACTER || c == UNIT_DEFINITION_CHARACTER ||
+		is_whitespace(c) || is_ignored_character(c)
+	);
 }
 
-inline bool is_end_of_line(char const & c)
+inline int count_trailing_zeros(uint64_t const & mask)
 {
-	return c == '\n' || c == '\0';
+	assert(mask != 0);
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward64(&index, mask);
+	return static_cast<int>(index);
+#else
+	return __builtin_ctzll(mask);
+#endif
 }
 
-// Move the stream so the next time `get()` is called it returns something else
-// than a white space.
-void skip_whitespaces(StringStream & stream)
+// Masks of a block of `SCAN_BLOCK_SIZE` characters. The bit `i` of a mask
+// refers to the character `i` of the block.
+struct ScanBlock
 {
-	// No need to check EOF because stream returns '\0' when EOF.
-	while(is_whitespace(stream.peek()))
-	{
-		stream.get();
-	}
-}
+	// The `\n` characters.
+	uint64_t new_lines;
 
-// Move the stream so the next time `get()` is called it returns the first
-// character after the current line.
-void skip_line(StringStream & stream)
+	// The characters validating `is_line_head()`.
+	uint64_t line_heads;
+};
+
+#if defined(LORG_SCANNER_AVX2)
+inline uint64_t get_equal_mask(__m256i const & characters, char const c)
 {
-	while(!is_end_of_line(stream.peek()))
-	{
-		stream.get();
-	}
+	__m256i const equal = _mm256_cmpeq_epi8(characters, _mm256_set1_epi8(c));
+	return static_cast<uint32_t>(_mm256_movemask_epi8(equal));
 }
-
-inline bool is_digit(char const & c)
+#elif defined(LORG_SCANNER_SSE2)
+inline uint64_t get_equal_mask(__m128i const & characters, char const c)
 {
-	return (48 <= c && c <= 57);
+	__m128i const equal = _mm_cmpeq_epi8(characters, _mm_set1_epi8(c));
+	return static_cast<uint32_t>(_mm_movemask_epi8(equal));
 }
+#endif
 
-// The value should be in the format `/[-+]?\d+(\.\d+)?/`.
-bool is_unit_value_ok(std::string const & value)
+// `block` must have at least `SCAN_BLOCK_SIZE` readable characters.
+ScanBlock scan_block(char const * block)
 {
-	if(value.size() == 0)
-	{
-		return false;
-	}
-
-	size_t i = 0;
-	// Check if has sign.
-	if(value[0] == '-' || value[0] == '+')
-	{
-		i = 1;
-	}
-
-	// Check if has only digits or digits then a decimal point for floats.
-	for(; i < value.size(); i++)
+	ScanBlock result = {0, 0};
+#if defined(LORG_SCANNER_AVX2) || defined(LORG_SCANNER_SSE2)
+#if defined(LORG_SCANNER_AVX2)
+	constexpr size_t vector_size = 32;
+#else
+	constexpr size_t vector_size = 16;
+#endif
+	for(size_t offset = 0; offset < SCAN_BLOCK_SIZE; offset += vector_size)
 	{
-		char const & c = value[i];
-		if(is_digit(c))
+#if defined(LORG_SCANNER_AVX2)
+		__m256i const characters = _mm256_loadu_si256(
+			reinterpret_cast<__m256i const *>(block + offset)
+		);
+#else
+		__m128i const characters = _mm_loadu_si128(
+			reinterpret_cast<__m128i const *>(block + offset)
+		);
+#endif
+		uint64_t line_heads = (
+			get_equal_mask(characters, NODE_DEFINITION_CHARACTER) |
+			get_equal_mask(characters, UNIT_DEFINITION_CHARACTER) |
+			get_equal_mask(characters, ' ') |
+			get_equal_mask(characters, '\t')
+		);
+		for(char const & ignored_character : IGNORED_CHARACTERS)
 		{
-			continue;
+			line_heads |= get_equal_mask(characters, ignored_character);
 		}
-		else if(c == '.')
+		result.new_lines |= get_equal_mask(characters, '\n') << offset;
+		result.line_heads |= line_heads << offset;
+	}
+#else
+	for(size_t i = 0; i < SCAN_BLOCK_SIZE; i++)
+	{
+		uint64_t const bit = uint64_t(1) << i;
+		if(block[i] == '\n')
 		{
-			break;
+			result.new_lines |= bit;
 		}
-		else
+		else if(is_line_head(block[i]))
 		{
-			return false;
+			result.line_heads |= bit;
 		}
 	}
+#endif
+	return result;
+}
 
-	// Check if this is the definition of an integer.
-	if(i == value.size() && value[value.size()-1] != '.')
+// Returns the index of the `\n` ending the line, or the content size if it is
+// the last line.
+inline size_t find_end_of_line(std::string_view content, size_t line_start)
+{
+	void const * end = std::memchr(
+		content.data() + line_start, '\n', content.size() - line_start
+	);
+	if(end == nullptr)
 	{
-		return true;
+		return content.size();
 	}
+	return static_cast<size_t>(static_cast<char const *>(end) - content.data());
+}
 
-	// Trailing points are not allowed.
-	if(i == value.size() - 1 && value[i] == '.')
-	{
-		return false;
-	}
+// The line numbers are only needed for the error messages, so they are
+// calculated only when an error is found.
+int get_line_number(std::string_view content, size_t index)
+{
+	auto const end = content.begin() + static_cast<std::ptrdiff_t>(index);
+	return 1 + static_cast<int>(std::count(content.begin(), end, '\n'));
+}
 
-	// Check the decimals of the supposedly float.
-	for(i = i + 1; i < value.size(); i++)
+size_t skip_whitespaces(std::string_view str, size_t i)
+{
+	while(i < str.size() && is_whitespace(str[i]))
 	{
-		if(is_digit(value[i]))
-		{
-			continue;
-		}
-		else
-		{
-			return false;
-		}
+		i++;
 	}
-	return true;
+	return i;
 }
 
-// `first_char` is needed because we often detect the need of getting the rest
-// of the line after checking the first character.
-// After this function ran, `stream.get()` returns the first character after
-// the line.
-std::string get_rest_of_line_without_trailing_spaces(
-	StringStream stream, const char first_char
-)
+std::string_view trim_trailing_whitespaces(std::string_view str)
 {
-	std::string content;
-	char c = first_char;
-	int trailing_space_count = 0;
-	while(!is_end_of_line(c))
-	{
-		content.push_back(c);
-		if(is_whitespace(c))
-		{
-			trailing_space_count++;
-		}
-		else
-		{
-			trailing_space_count = 0;
-		}
-		c = stream.get();
-	}
-	if(trailing_space_count > 0)
+	size_t size = str.size();
+	while(size > 0 && is_whitespace(str[size-1]))
 	{
-		content.resize(content.size() - trailing_space_count);
+		size--;
 	}
-	return content;
+	return str.substr(0, size);
+}
+
+std::string_view trim_whitespaces(std::string_view str)
+{
+	return trim_trailing_whitespaces(str.substr(skip_whitespaces(str, 0)));
 }
 
-// Returns a substring from `start` included to `end` excluded. Trim the spaces.
-std::string get_substring_without_leading_trailing_spaces(
-	std::string const & str, size_t start, size_t end
+// Returns the line without the ignored characters. `buffer` is only used if
+// the line contains some of them.
+std::string_view remove_ignored_characters(
+	std::string_view line, std::string & buffer
 )
 {
-	assert(start <= end);
-	assert(start < str.size());
-	assert(end <= str.size());
-	std::string substring;
-	// Skip leading spaces.
-	while(is_whitespace(str[start]) && start < end)
-	{
-		start++;
-	}
-	// All characters were white spaces.
-	if(start == end)
+	auto it = std::find_if(line.begin(), line.end(), is_ignored_character);
+	if(it == line.end())
 	{
-		return substring;
+		return line;
 	}
-	// Skip trailing spaces.
-	while(is_whitespace(str[end-1]) && start < end)
+	buffer.assign(line.begin(), it);
+	for(; it != line.end(); it++)
 	{
-		end--;
-	}
-	// Return the substring.
-	for(size_t i = start; i < end; i++)
-	{
-		substring.push_back(str[i]);
+		if(!is_ignored_character(*it))
+		{
+			buffer.push_back(*it);
+		}
 	}
-	return substring;
+	return buffer;
 }
 
 std::string format_error(std::string const message, int line, int column = 0)
@@ -342,283 +294,2512 @@ std::string get_error_message_unit_outside_node(int line)
 	);
 }
 
-ConvertStringToNodesResult create_ConvertStringToNodesResult_error(
-	std::string error_message
-)
+ParserResult create_ParserResult_error(std::string error_message)
 {
-	ConvertStringToNodesResult result;
-	result.parser_result.has_error = true;
-	result.parser_result.error_message = error_message;
+	ParserResult result;
+	result.has_error = true;
+	result.error_message = error_message;
 	return result;
 }
 
-ConvertStringToNodesResult convert_string_to_nodes(std::string const & content)
+// Returns the node or unit definition of the line, starting at its first
+// `NODE_DEFINITION_CHARACTER` or `UNIT_DEFINITION_CHARACTER` and without the
+// ignored characters. It is empty if the line is a comment or is empty.
+// `buffer` is only used if the line contains ignored characters.
+std::string_view get_definition(std::string_view line, std::string & buffer)
 {
-	ConvertStringToNodesResult result;
-	result.parser_result.has_error = false;
-	result.parser_result.total_node = std::make_unique<Node>();
+	// Skip useless possible white spaces at the beginning of the line.
+	size_t i = 0;
+	while(i < line.size() && (is_whitespace(line[i]) || is_ignored_character(line[i])))
+	{
+		i++;
+	}
+	if(i == line.size())
+	{
+		return std::string_view();
+	}
+
+	// All the other lines are comments.
+	char const c = line[i];
+	if(c != NODE_DEFINITION_CHARACTER && c != UNIT_DEFINITION_CHARACTER)
+	{
+		return std::string_view();
+	}
+	return remove_ignored_characters(line.substr(i), buffer);
+}
 
-	Node & total_node = *(result.parser_result.total_node);
-	total_node.title = "TOTAL";
+struct NodeDefinition
+{
+	size_t level;
 
-	StringStream stream(content);
+	// Empty if the node has no title.
+	std::string_view title;
+};
 
-	// Contain the node currently being parsed. We use a stack to avoid
-	// unnecessary recursion. The stack size represents the level of the node
-	// on top. The node below it is its direct parent.
-	std::stack<std::unique_ptr<Node>> nodes_to_add;
+NodeDefinition read_node_definition(std::string_view line)
+{
+	NodeDefinition definition;
 
-	while(!stream.eof())
+	// Get node level.
+	size_t i = 0;
+	definition.level = 0;
+	while(i < line.size() && line[i] == NODE_DEFINITION_CHARACTER)
 	{
-		// Skip useless possible white spaces at the beginning of the line.
-		if(stream.column == 0 && is_whitespace(stream.peek()))
-		{
-			skip_whitespaces(stream);
-			if(stream.eof())
-			{
-				break;
-			}
-		}
+		definition.level++;
+		i++;
+	}
 
-		char c = stream.get();
+	// Get node title.
+	definition.title = trim_trailing_whitespaces(
+		line.substr(skip_whitespaces(line, i))
+	);
+	return definition;
+}
 
-		if(c == NODE_DEFINITION_CHARACTER)
-		{
-			// Keep the current line because maybe the node definition is
-			// ill-formed, and when we detect it the stream is pointing to the
-			// next line.
-			int current_line = stream.line;
+enum class UnitDefinitionStatus
+{
+	OK,
+	ILL_FORMED,
+	// The value is well-formed but cannot be represented, see `UnitValues`.
+	INCORRECT_VALUE
+};
 
-			// Get node level.
-			size_t level = 0;
-			while(c == NODE_DEFINITION_CHARACTER)
-			{
-				level++;
-				c = stream.get();
-			}
+UnitDefinitionStatus read_unit_definition(
+	std::string_view line, std::string_view & name, UnitValue & value
+)
+{
+	// We get all the line immediately because unit names can contain
+	// `UNIT_NAME_VALUE_SEPARATOR`.
+	std::string_view definition = trim_trailing_whitespaces(
+		line.substr(skip_whitespaces(line, 1))
+	);
 
-			// Get node title.
-			if(is_whitespace(c))
-			{
-				skip_whitespaces(stream);
-			}
-			c = stream.get();
-			if(is_end_of_line(c))
-			{
-				return create_ConvertStringToNodesResult_error(
-					get_error_message_node_without_title(current_line)
-				);
-			}
-			std::string title = get_rest_of_line_without_trailing_spaces(stream, c);
+	// We get the last `UNIT_NAME_VALUE_SEPARATOR` index so it is sure that
+	// everything before it is part of the unit name.
+	size_t const separator_index = definition.rfind(UNIT_NAME_VALUE_SEPARATOR);
+	std::string_view value_string;
+	name = std::string_view();
+	if(separator_index != std::string_view::npos)
+	{
+		name = trim_whitespaces(definition.substr(0, separator_index));
+		value_string = trim_whitespaces(definition.substr(separator_index + 1));
+	}
+	DecimalNumber number;
+	if(name.empty() || !read_decimal_number(value_string, number))
+	{
+		return UnitDefinitionStatus::ILL_FORMED;
+	}
+	if(!UnitValues::read(number, value))
+	{
+		return UnitDefinitionStatus::INCORRECT_VALUE;
+	}
+	return UnitDefinitionStatus::OK;
+}
 
-			// Manage hierarchy.
-			if(level > nodes_to_add.size() + 1)
-			{
-				return create_ConvertStringToNodesResult_error(
-					get_error_message_node_without_direct_parent(current_line)
-				);
-			}
-			while(level < nodes_to_add.size() + 1)
-			{
-				// Moving the siblings and nephews until the top of the stack
-				// is the direct parent of the current node.
-				std::unique_ptr<Node> other = std::move(nodes_to_add.top());
-				nodes_to_add.pop();
-				if(nodes_to_add.size() > 0)
-				{
-					nodes_to_add.top()->children.push_back(std::move(other));
-				}
-				else
-				{
-					total_node.children.push_back(std::move(other));
-				}
-			}
-			auto current_node = std::make_unique<Node>();
-			current_node->title = title;
-			nodes_to_add.push(std::move(current_node));
-		}
-		else if(c == UNIT_DEFINITION_CHARACTER)
-		{
-			// Keep the current line because maybe the node definition is
-			// ill-formed, and when we detect it the stream is pointing to the
-			// next line.
-			int current_line = stream.line;
-
-			// We get all the line immediately because unit names can contain
-			// `UNIT_NAME_VALUE_SEPARATOR`.
-			skip_whitespaces(stream);
-			std::string definition = get_rest_of_line_without_trailing_spaces(stream, stream.get());
-			if(definition.empty())
-			{
-				return create_ConvertStringToNodesResult_error(
-					get_error_message_unit_definition_ill_formed(current_line)
-				);
-			}
+// A unit defined in a chunk.
+struct ChunkUnit
+{
+	// The local unit ID, see `ChunkParser::unit_definitions`.
+	size_t id;
+	UnitValue value;
+};
 
-			// We get the last `UNIT_NAME_VALUE_SEPARATOR` index so it is sure
-			// that everything before it is part of the unit name.
-			size_t separator_index = definition.size() - 1;
-			{
-				for(; separator_index > 0; separator_index--)
-				{
-					if(definition[separator_index] == UNIT_NAME_VALUE_SEPARATOR)
-					{
-						break;
-					}
-				}
-				if(definition[separator_index] != UNIT_NAME_VALUE_SEPARATOR)
-				{
-					return create_ConvertStringToNodesResult_error(
-						get_error_message_unit_definition_ill_formed(current_line)
-					);
-				}
-			}
-			// The only thing in the node definition is `UNIT_DEFINITION_CHARACTER`.
-			if(definition.size() == 1)
-			{
-				return create_ConvertStringToNodesResult_error(
-					get_error_message_unit_definition_ill_formed(current_line)
-				);
-			}
+// Parse the lines of a chunk of the content. The nodes are defined in
+// pre-order, so the nodes of a chunk follow the nodes of the previous chunks
+// in the tree. The chunks can be parsed independently because the only
+// things depending on the previous chunks are:
+// - whether the first node of the chunk has a direct parent, which only
+//   depends on the level of the node before it;
+// - the units defined before the first node of the chunk, which belong to
+//   the node before it.
+// They are checked when the chunks are stitched together.
+struct ChunkParser
+{
+	// The whole content. The line numbers are calculated from it.
+	std::string_view content;
 
-			// Get name.
-			std::string name = get_substring_without_leading_trailing_spaces(
-				definition, 0, separator_index
-			);
-			if(name.empty())
-			{
-				return create_ConvertStringToNodesResult_error(
-					get_error_message_unit_definition_ill_formed(current_line)
-				);
-			}
+	// The chunk is from `start` included to `end` excluded. Both are at the
+	// beginning of a line.
+	size_t start;
+	size_t end;
 
-			// Get value.
-			std::string value_string = get_substring_without_leading_trailing_spaces(
-				definition, separator_index + 1, definition.size()
-			);
-			if(value_string.empty())
-			{
-				return create_ConvertStringToNodesResult_error(
-					get_error_message_unit_definition_ill_formed(current_line)
-				);
-			}
-			if(!is_unit_value_ok(value_string))
-			{
-				return create_ConvertStringToNodesResult_error(
-					get_error_message_unit_definition_ill_formed(current_line)
-				);
-			}
+	bool has_error;
+	std::string error_message;
 
-			// Check the unit definition is not outside of a node. We prefer to
-			// do that after checking the syntax of the unit definition.
-			if(nodes_to_add.empty())
-			{
-				return create_ConvertStringToNodesResult_error(
-					get_error_message_unit_outside_node(current_line)
-				);
-			}
+	// The unit definitions in the order of their first appearance in the
+	// chunk. The units of the parsed nodes refer to these "local" unit IDs
+	// until the chunks are stitched together.
+	std::vector<UnitDefinition> unit_definitions;
 
-			Unit unit;
-			unit.name = name;
-			unit.value = std::stof(value_string);
-			unit.is_real = true;
-			unit.is_ignored = false;
-			nodes_to_add.top()->units[unit.name] = unit;
-			result.existing_units.insert(unit.name);
-		}
-		else if(c == '\n')
-		{
-			continue;
-		}
-		else
-		{
-			skip_line(stream);
-		}
+	// Map the unit names to their local unit ID.
+	std::map<std::string, size_t, std::less<>> unit_ids;
+
+	// The nodes of the chunk in the order of their definition.
+	std::vector<size_t> levels;
+	std::string titles;
+	std::vector<size_t> title_offsets;
+	size_t first_node_line_start;
+
+	// The units in the order of their definition. The units of the node `k`
+	// start at `unit_starts[k]`. The ones before the first node of the chunk
+	// belong to the last node of the previous chunks.
+	std::vector<ChunkUnit> units;
+	std::vector<size_t> unit_starts;
+	size_t first_leading_unit_line_start;
+
+	// Used to remove the ignored characters from a line.
+	std::string line_buffer;
+
+	ChunkParser(std::string_view content, size_t start, size_t end):
+		content(content), start(start), end(end),
+		has_error(false),
+		first_node_line_start(std::string_view::npos),
+		first_leading_unit_line_start(std::string_view::npos)
+	{
 	}
 
-	if(!nodes_to_add.empty())
+	size_t get_node_count() const noexcept
 	{
-		while(nodes_to_add.size() > 1)
-		{
-			std::unique_ptr<Node> other = std::move(nodes_to_add.top());
-			nodes_to_add.pop();
-			nodes_to_add.top()->children.push_back(std::move(other));
-		}
-		total_node.children.push_back(std::move(nodes_to_add.top()));
-		nodes_to_add.pop();
+		return levels.size();
 	}
 
-	return result;
+	size_t get_leading_unit_count() const noexcept
+	{
+		return unit_starts.empty() ? units.size() : unit_starts.front();
+	}
+};
+
+void set_error(ChunkParser & parser, std::string error_message)
+{
+	parser.has_error = true;
+	parser.error_message = error_message;
 }
 
-void update_node_unit_values(
-	Node & node, std::set<std::string> existing_units,
-	std::set<std::string> units_to_ignore
+void parse_node_definition(
+	ChunkParser & parser, std::string_view line, size_t line_start
 )
 {
-	std::map<std::string, Unit> & units = node.units;
+	NodeDefinition const definition = read_node_definition(line);
+	size_t const level = definition.level;
+	if(definition.title.empty())
+	{
+		set_error(
+			parser,
+			get_error_message_node_without_title(
+				get_line_number(parser.content, line_start)
+			)
+		);
+		return;
+	}
 
-	// Add all missing units and define which ones need to be calculated.
-	std::set<std::string> units_to_calculate;
-	for(auto const & unit_name : existing_units)
+	// A node can be at most one level below the previous node, which is then
+	// its parent. The first node of the chunk is checked when the chunks are
+	// stitched together.
+	if(parser.levels.empty())
 	{
-		if(units.find(unit_name) == units.end())
-		{
-			Unit unit;
-			unit.name = unit_name;
-			unit.value = 0.0f;
-			unit.is_ignored = false;
-			unit.is_real = false;
-			units[unit_name] = unit;
-			units_to_calculate.insert(unit_name);
-		}
+		parser.first_node_line_start = line_start;
 	}
+	else if(level > parser.levels.back() + 1)
+	{
+		set_error(
+			parser,
+			get_error_message_node_without_direct_parent(
+				get_line_number(parser.content, line_start)
+			)
+		);
+		return;
+	}
+
+	parser.levels.push_back(level);
+	parser.title_offsets.push_back(parser.titles.size());
+	parser.titles.append(definition.title);
+	parser.unit_starts.push_back(parser.units.size());
+}
 
-	// Ignore all units to ignore and set the one the children should ignore.
-	std::set<std::string> children_units_to_ignore;
-	for(auto & unit_pair : units)
+void parse_unit_definition(
+	ChunkParser & parser, std::string_view line, size_t line_start
+)
+{
+	std::string_view name;
+	UnitValue value;
+	UnitDefinitionStatus const status = read_unit_definition(line, name, value);
+	if(status != UnitDefinitionStatus::OK)
 	{
-		Unit & unit = unit_pair.second;
-		if(units_to_ignore.find(unit.name) != units_to_ignore.end())
-		{
-			unit.is_ignored = true;
-			children_units_to_ignore.insert(unit.name);
-		}
-		if(unit.is_real)
-		{
-			children_units_to_ignore.insert(unit.name);
-		}
+		int const line_number = get_line_number(parser.content, line_start);
+		set_error(
+			parser,
+			status == UnitDefinitionStatus::ILL_FORMED ?
+			get_error_message_unit_definition_ill_formed(line_number) :
+			get_error_message_unit_value_incorrect(line_number)
+		);
+		return;
 	}
 
-	// Update the children.
-	for(std::unique_ptr<Node> & child : node.children)
+	auto id_it = parser.unit_ids.find(name);
+	if(id_it == parser.unit_ids.end())
 	{
-		update_node_unit_values(*child, existing_units, children_units_to_ignore);
+		UnitDefinition unit_definition;
+		unit_definition.name = name;
+		parser.unit_definitions.push_back(unit_definition);
+		id_it = parser.unit_ids.emplace(name, parser.unit_ids.size()).first;
 	}
 
-	// Update the units to calculate.
-	for(std::unique_ptr<Node> & child : node.children)
+	ChunkUnit unit;
+	unit.id = id_it->second;
+	unit.value = value;
+
+	// Whether the unit definition is outside of a node is checked when the
+	// chunks are stitched together, after checking the syntax of the unit
+	// definition.
+	if(
+		parser.levels.empty() &&
+		parser.first_leading_unit_line_start == std::string_view::npos
+	)
 	{
-		for(auto & unit_pair : units)
-		{
-			Unit & unit = unit_pair.second;
-			if(!unit.is_real)
-			{
-				unit.value += child->units[unit.name].value;
-			}
-		}
+		parser.first_leading_unit_line_start = line_start;
 	}
+	parser.units.push_back(unit);
 }
 
-ParserResult lorg::parse(std::string const & content)
+// Parse the line starting at `line_start`, which is not empty and starts
+// with a character validating `is_line_head()`. Returns the index of the
+// `\n` ending the line, or the content size if it is the last line. The
+// parser holds an error if the line is incorrect.
+size_t parse_line(ChunkParser & parser, size_t line_start)
 {
-	ConvertStringToNodesResult result = convert_string_to_nodes(content);
-	if(result.parser_result.has_error)
+	std::string_view const content = parser.content;
+	size_t const line_end = find_end_of_line(content, line_start);
+
+	std::string_view const line = get_definition(
+		content.substr(line_start, line_end - line_start), parser.line_buffer
+	);
+	if(line.empty())
 	{
-		return std::move(result.parser_result);
+		return line_end;
 	}
-	update_node_unit_values(
-		*(result.parser_result.total_node), result.existing_units, {}
-	);
-	return std::move(result.parser_result);
+	if(line[0] == NODE_DEFINITION_CHARACTER)
+	{
+		parse_node_definition(parser, line, line_start);
+	}
+	else
+	{
+		parse_unit_definition(parser, line, line_start);
+	}
+	return line_end;
+}
+
+// Call `handle_line(line_start)` for each line from `start` to `end` that may
+// be a node or unit definition, the other ones are comments. It returns the
+// index of the `\n` ending the line, or the content size if it is the last
+// line, or `npos` to stop scanning.
+//
+// The content is scanned by blocks to find the beginning of the lines to
+// handle.
+template<typename LineHandler>
+void scan_lines(
+	std::string_view content, size_t start, size_t end, LineHandler const & handle_line
+)
+{
+	// `next_line_start` is the first character that has not been handled
+	// yet. It is always at the beginning of a line.
+	size_t next_line_start = start;
+	size_t block_start = start;
+	bool is_block_start_line_start = true;
+	while(block_start < end)
+	{
+		ScanBlock block;
+		size_t const remaining_size = end - block_start;
+		if(remaining_size >= SCAN_BLOCK_SIZE)
+		{
+			block = scan_block(content.data() + block_start);
+		}
+		else
+		{
+			// The padding characters are neither `\n` nor line heads.
+			char last_block[SCAN_BLOCK_SIZE] = {};
+			std::memcpy(last_block, content.data() + block_start, remaining_size);
+			block = scan_block(last_block);
+		}
+		size_t const block_end = block_start + SCAN_BLOCK_SIZE;
+
+		uint64_t line_starts = block.new_lines << 1;
+		if(is_block_start_line_start)
+		{
+			line_starts |= 1;
+		}
+		is_block_start_line_start = (block.new_lines >> (SCAN_BLOCK_SIZE - 1)) != 0;
+
+		uint64_t lines_to_handle = line_starts & block.line_heads;
+		while(lines_to_handle != 0)
+		{
+			size_t const line_start = block_start + static_cast<size_t>(
+				count_trailing_zeros(lines_to_handle)
+			);
+			lines_to_handle &= lines_to_handle - 1;
+
+			// The line was already handled with the previous one.
+			if(line_start < next_line_start)
+			{
+				continue;
+			}
+			size_t const line_end = handle_line(line_start);
+			if(line_end == std::string_view::npos)
+			{
+				return;
+			}
+			next_line_start = line_end + 1;
+			if(next_line_start >= block_end)
+			{
+				break;
+			}
+		}
+
+		// The last handled line may end after this block.
+		if(next_line_start > block_end)
+		{
+			block_start = next_line_start;
+			is_block_start_line_start = true;
+		}
+		else
+		{
+			block_start = block_end;
+		}
+	}
+}
+
+void parse_chunk(ChunkParser & parser)
+{
+	scan_lines(
+		parser.content, parser.start, parser.end,
+		[&parser](size_t line_start)
+		{
+			size_t const line_end = parse_line(parser, line_start);
+			return parser.has_error ? std::string_view::npos : line_end;
+		}
+	);
+}
+
+// Returns the local unit IDs converted to the global ones.
+std::vector<size_t> merge_unit_definitions(
+	std::vector<UnitDefinition> & unit_definitions,
+	std::map<std::string, size_t, std::less<>> & unit_ids,
+	ChunkParser const & chunk
+)
+{
+	std::vector<size_t> global_ids;
+	for(UnitDefinition const & unit_definition : chunk.unit_definitions)
+	{
+		auto id_it = unit_ids.find(unit_definition.name);
+		if(id_it == unit_ids.end())
+		{
+			unit_definitions.push_back(unit_definition);
+			id_it = unit_ids.emplace(unit_definition.name, unit_ids.size()).first;
+		}
+		global_ids.push_back(id_it->second);
+	}
+	return global_ids;
+}
+
+bool lorg::is_parsed_in_chunks(size_t size) noexcept
+{
+	return size / MIN_CHUNK_SIZE > 1;
+}
+
+// Split the content into chunks of similar sizes. Each chunk starts at the
+// beginning of a line.
+std::vector<ChunkParser> split_into_chunks(std::string_view content, size_t jobs)
+{
+	size_t const chunk_count = std::max<size_t>(
+		1, std::min(jobs, content.size() / MIN_CHUNK_SIZE)
+	);
+	std::vector<ChunkParser> chunks;
+	size_t start = 0;
+	for(size_t i = 1; i <= chunk_count && start < content.size(); i++)
+	{
+		size_t end = content.size();
+		if(i < chunk_count)
+		{
+			end = std::max(start, content.size() / chunk_count * i);
+			end = std::min(find_end_of_line(content, end) + 1, content.size());
+		}
+		chunks.push_back(ChunkParser(content, start, end));
+		start = end;
+	}
+	return chunks;
+}
+
+void set_real_unit(Tree & tree, size_t i, size_t id, UnitValue value)
+{
+	tree.values[i * tree.unit_count + id] = value;
+	size_t const word = i * tree.get_mask_word_count() + id / 64;
+	tree.real_masks[word] |= uint64_t(1) << (id % 64);
+}
+
+ParserResult convert_string_to_nodes(std::string_view content, ThreadPool * pool)
+{
+	ParserResult result;
+	result.has_error = false;
+
+	size_t const jobs = pool == nullptr ? 1 : pool->get_thread_count();
+	std::vector<ChunkParser> chunks = split_into_chunks(content, jobs);
+	run_in_parallel(
+		pool, chunks.size(),
+		[&chunks](size_t i)
+		{
+			parse_chunk(chunks[i]);
+		}
+	);
+
+	// Stitch the chunks together in order. The nodes of a chunk follow the
+	// nodes of the previous ones.
+	std::vector<size_t> first_nodes;
+	std::vector<size_t> first_title_offsets;
+	size_t node_count = 1;
+	size_t titles_size = TOTAL_NODE_TITLE.size();
+	size_t previous_level = 0;
+	for(ChunkParser const & chunk : chunks)
+	{
+		// Report the first error of the content. The chunk stopped at its
+		// own error, but the errors depending on the previous chunks can be
+		// before it.
+		if(chunk.get_leading_unit_count() > 0 && node_count == 1)
+		{
+			return create_ParserResult_error(
+				get_error_message_unit_outside_node(
+					get_line_number(content, chunk.first_leading_unit_line_start)
+				)
+			);
+		}
+		if(!chunk.levels.empty() && chunk.levels.front() > previous_level + 1)
+		{
+			return create_ParserResult_error(
+				get_error_message_node_without_direct_parent(
+					get_line_number(content, chunk.first_node_line_start)
+				)
+			);
+		}
+		if(chunk.has_error)
+		{
+			return create_ParserResult_error(chunk.error_message);
+		}
+
+		first_nodes.push_back(node_count);
+		first_title_offsets.push_back(titles_size);
+		node_count += chunk.get_node_count();
+		titles_size += chunk.titles.size();
+		if(!chunk.levels.empty())
+		{
+			previous_level = chunk.levels.back();
+		}
+	}
+
+	// The unit IDs are defined in the order of their first appearance in the
+	// content, so the first chunk keeps its unit IDs.
+	std::map<std::string, size_t, std::less<>> unit_ids;
+	std::vector<std::vector<size_t>> chunk_global_ids;
+	for(ChunkParser const & chunk : chunks)
+	{
+		chunk_global_ids.push_back(
+			merge_unit_definitions(result.unit_definitions, unit_ids, chunk)
+		);
+	}
+
+	Tree & tree = result.tree;
+	tree.unit_count = result.unit_definitions.size();
+	size_t const word_count = tree.get_mask_word_count();
+	tree.parents.resize(node_count);
+	tree.subtree_ends.resize(node_count);
+	tree.depths.resize(node_count);
+	tree.titles.resize(titles_size);
+	tree.title_offsets.resize(node_count);
+	tree.values.resize(node_count * tree.unit_count);
+	tree.real_masks.resize(node_count * word_count);
+	tree.ignored_masks.resize(node_count * word_count);
+
+	tree.depths[0] = 0;
+	tree.titles.replace(0, TOTAL_NODE_TITLE.size(), TOTAL_NODE_TITLE);
+	tree.title_offsets[0] = 0;
+
+	// Each chunk fills its own nodes.
+	run_in_parallel(
+		pool, chunks.size(),
+		[&chunks, &chunk_global_ids, &first_nodes, &first_title_offsets, &tree](size_t c)
+		{
+			ChunkParser const & chunk = chunks[c];
+			std::vector<size_t> const & global_ids = chunk_global_ids[c];
+			size_t const first_node = first_nodes[c];
+			size_t const first_title_offset = first_title_offsets[c];
+
+			std::copy(
+				chunk.levels.begin(), chunk.levels.end(),
+				tree.depths.begin() + static_cast<std::ptrdiff_t>(first_node)
+			);
+			std::copy(
+				chunk.titles.begin(), chunk.titles.end(),
+				tree.titles.begin() + static_cast<std::ptrdiff_t>(first_title_offset)
+			);
+			for(size_t k = 0; k < chunk.get_node_count(); k++)
+			{
+				tree.title_offsets[first_node + k] = (
+					first_title_offset + chunk.title_offsets[k]
+				);
+
+				size_t const units_end = (
+					k + 1 < chunk.get_node_count() ?
+					chunk.unit_starts[k + 1] : chunk.units.size()
+				);
+				for(size_t u = chunk.unit_starts[k]; u < units_end; u++)
+				{
+					ChunkUnit const & unit = chunk.units[u];
+					set_real_unit(tree, first_node + k, global_ids[unit.id], unit.value);
+				}
+			}
+		}
+	);
+
+	// The units defined before the first node of a chunk belong to the last
+	// node before it, and can replace its units.
+	for(size_t c = 0; c < chunks.size(); c++)
+	{
+		ChunkParser const & chunk = chunks[c];
+		for(size_t u = 0; u < chunk.get_leading_unit_count(); u++)
+		{
+			ChunkUnit const & unit = chunk.units[u];
+			set_real_unit(
+				tree, first_nodes[c] - 1, chunk_global_ids[c][unit.id], unit.value
+			);
+		}
+	}
+
+	// The parent of a node is the last node defined before it with a level
+	// lower by one.
+	std::vector<size_t> last_nodes = {0};
+	tree.parents[0] = 0;
+	for(size_t i = 1; i < node_count; i++)
+	{
+		last_nodes.resize(tree.depths[i]);
+		tree.parents[i] = last_nodes.back();
+		last_nodes.push_back(i);
+	}
+
+	// A subtree ends where the subtree of its last descendant ends.
+	for(size_t i = node_count; i-- > 0;)
+	{
+		tree.subtree_ends[i] = std::max(tree.subtree_ends[i], i + 1);
+		if(i > 0)
+		{
+			size_t & parent_end = tree.subtree_ends[tree.parents[i]];
+			parent_end = std::max(parent_end, tree.subtree_ends[i]);
+		}
+	}
+
+	return result;
+}
+
+// Set the units of the node that are ignored: the ones either ignored or
+// real in the parent. It means an ancestor already defines their value.
+// The parent must already be updated.
+void update_ignored_units(Tree & tree, size_t i)
+{
+	size_t const word_count = tree.get_mask_word_count();
+	size_t const parent = tree.parents[i];
+	for(size_t w = 0; w < word_count; w++)
+	{
+		tree.ignored_masks[i * word_count + w] = (
+			tree.ignored_masks[parent * word_count + w] |
+			tree.real_masks[parent * word_count + w]
+		);
+	}
+}
+
+// Calculate the units of the node that are not real. All the children must
+// already be updated.
+void sum_children_units(Tree & tree, size_t i)
+{
+	size_t const unit_count = tree.unit_count;
+	UnitValue * values = tree.values.data() + i * unit_count;
+	uint64_t const * real_mask = (
+		tree.real_masks.data() + i * tree.get_mask_word_count()
+	);
+
+	// The compensations of each thread are kept between the nodes.
+	UnitValue * compensations = nullptr;
+	if constexpr(UnitValues::IS_COMPENSATED)
+	{
+		thread_local std::vector<UnitValue> thread_compensations;
+		thread_compensations.assign(unit_count, 0);
+		compensations = thread_compensations.data();
+	}
+
+	size_t const end = tree.subtree_ends[i];
+	for(size_t child = i + 1; child < end; child = tree.subtree_ends[child])
+	{
+		UnitValue const * child_values = tree.values.data() + child * unit_count;
+		add_child_units<UnitValues>(
+			values, compensations, child_values, real_mask, unit_count
+		);
+	}
+	finish_child_units<UnitValues>(values, compensations, real_mask, unit_count);
+}
+
+// Update the nodes from `first` included to `last` excluded. The range must
+// be made of whole sibling subtrees whose parent is already updated, or be
+// the whole tree.
+//
+// The ignored units are set from the parents, which come first, then the
+// other units are calculated from the children, which come last.
+void update_range(Tree & tree, size_t first, size_t last)
+{
+	for(size_t i = std::max<size_t>(first, 1); i < last; i++)
+	{
+		update_ignored_units(tree, i);
+	}
+	for(size_t i = last; i-- > first;)
+	{
+		sum_children_units(tree, i);
+	}
+}
+
+struct ParallelUpdate
+{
+	Tree & tree;
+	ThreadPool & pool;
+
+	// The number of tasks not finished yet for the children of each node
+	// split into several tasks.
+	std::unique_ptr<std::atomic<size_t>[]> pending_task_counts;
+
+	ParallelUpdate(Tree & tree, ThreadPool & pool):
+		tree(tree),
+		pool(pool),
+		pending_task_counts(new std::atomic<size_t>[tree.get_node_count()])
+	{
+	}
+};
+
+// Called when a task updating children of the node is done. The last one
+// calculates the node, then does the same for its parent.
+void finish_children_task(ParallelUpdate & update, size_t i)
+{
+	while(update.pending_task_counts[i].fetch_sub(1) == 1)
+	{
+		sum_children_units(update.tree, i);
+		if(i == 0)
+		{
+			return;
+		}
+		i = update.tree.parents[i];
+	}
+}
+
+// Update the subtree of a node whose parent is already updated. The
+// subtrees of the children bigger than `UPDATE_TASK_SIZE` are updated by
+// their own task, the smaller ones are grouped into tasks of at least that
+// size.
+void update_subtree(ParallelUpdate & update, size_t i)
+{
+	Tree & tree = update.tree;
+	if(i > 0)
+	{
+		update_ignored_units(tree, i);
+	}
+
+	// This task counts as one until all the others are created.
+	std::atomic<size_t> & pending_task_count = update.pending_task_counts[i];
+	pending_task_count = 1;
+
+	size_t range_start = tree.subtree_ends[i];
+	size_t range_end = range_start;
+	auto spawn_range = [&update, &pending_task_count, &range_start, &range_end, i]()
+	{
+		if(range_start == range_end)
+		{
+			return;
+		}
+		pending_task_count++;
+		size_t const first = range_start;
+		size_t const last = range_end;
+		update.pool.spawn(
+			[&update, first, last, i]()
+			{
+				update_range(update.tree, first, last);
+				finish_children_task(update, i);
+			}
+		);
+		range_start = range_end;
+	};
+
+	size_t const end = tree.subtree_ends[i];
+	for(size_t child = i + 1; child < end; child = tree.subtree_ends[child])
+	{
+		size_t const child_end = tree.subtree_ends[child];
+		if(child_end - child > UPDATE_TASK_SIZE)
+		{
+			spawn_range();
+			pending_task_count++;
+			update.pool.spawn(
+				[&update, child]()
+				{
+					update_subtree(update, child);
+				}
+			);
+			continue;
+		}
+		if(range_start == range_end)
+		{
+			range_start = child;
+		}
+		range_end = child_end;
+		if(range_end - range_start >= UPDATE_TASK_SIZE)
+		{
+			spawn_range();
+		}
+	}
+	spawn_range();
+	finish_children_task(update, i);
+}
+
+void update_node_unit_values(ParserResult & result, ThreadPool * pool)
+{
+	Tree & tree = result.tree;
+	if(pool == nullptr || tree.get_node_count() <= UPDATE_TASK_SIZE)
+	{
+		update_range(tree, 0, tree.get_node_count());
+		return;
+	}
+	ParallelUpdate update(tree, *pool);
+	pool->spawn(
+		[&update]()
+		{
+			update_subtree(update, 0);
+		}
+	);
+	pool->wait();
+}
+
+// The contents of the nodes of a tree, each from the start of its definition
+// line to the start of the next one, indexed like the nodes. The content of
+// the total node starts at the start of the content.
+struct NodeContents
+{
+	std::vector<size_t> starts;
+	std::vector<size_t> levels;
+
+	size_t get_end(std::string_view content, size_t i) const noexcept
+	{
+		return i + 1 < starts.size() ? starts[i + 1] : content.size();
+	}
+};
+
+// Only the node definition lines are read, the nodes are not checked.
+NodeContents split_into_node_contents(std::string_view content)
+{
+	NodeContents contents;
+	contents.starts.push_back(0);
+	contents.levels.push_back(0);
+	std::string line_buffer;
+	scan_lines(
+		content, 0, content.size(),
+		[content, &contents, &line_buffer](size_t line_start)
+		{
+			// The lines are only handled from their start, so the unit
+			// definitions can be skipped without finding their end.
+			if(content[line_start] == UNIT_DEFINITION_CHARACTER)
+			{
+				return line_start;
+			}
+			size_t const line_end = find_end_of_line(content, line_start);
+			std::string_view const line = get_definition(
+				content.substr(line_start, line_end - line_start), line_buffer
+			);
+			if(!line.empty() && line[0] == NODE_DEFINITION_CHARACTER)
+			{
+				contents.starts.push_back(line_start);
+				contents.levels.push_back(read_node_definition(line).level);
+			}
+			return line_end;
+		}
+	);
+	return contents;
+}
+
+inline uint64_t mix_hash(uint64_t hash, uint64_t word)
+{
+	constexpr uint64_t MULTIPLIER = 0x9e3779b97f4a7c15;
+	hash = (hash ^ word) * MULTIPLIER;
+	return hash ^ (hash >> 29);
+}
+
+uint64_t lorg::hash_bytes(std::string_view bytes) noexcept
+{
+	uint64_t hash = mix_hash(0, bytes.size());
+	size_t i = 0;
+	for(; i + sizeof(uint64_t) <= bytes.size(); i += sizeof(uint64_t))
+	{
+		uint64_t word;
+		std::memcpy(&word, bytes.data() + i, sizeof(word));
+		hash = mix_hash(hash, word);
+	}
+	if(i < bytes.size())
+	{
+		uint64_t word = 0;
+		std::memcpy(&word, bytes.data() + i, bytes.size() - i);
+		hash = mix_hash(hash, word);
+	}
+	return hash ^ (hash >> 32);
+}
+
+std::vector<uint64_t> hash_node_contents(
+	std::string_view content, NodeContents const & contents
+)
+{
+	std::vector<uint64_t> hashes(contents.starts.size());
+	for(size_t i = 0; i < hashes.size(); i++)
+	{
+		size_t const start = contents.starts[i];
+		hashes[i] = hash_bytes(content.substr(start, contents.get_end(content, i) - start));
+	}
+	return hashes;
+}
+
+// Whether each unit of the mask is still real in a node of the tree.
+bool are_units_defined(Tree const & tree, size_t w, uint64_t units)
+{
+	size_t const word_count = tree.get_mask_word_count();
+	for(size_t i = 0; i < tree.get_node_count() && units != 0; i++)
+	{
+		units &= ~tree.real_masks[i * word_count + w];
+	}
+	return units == 0;
+}
+
+// Reset the units of the node that are not real, before they are calculated
+// again.
+void clear_calculated_units(Tree & tree, size_t i)
+{
+	size_t const word_count = tree.get_mask_word_count();
+	for(size_t id = 0; id < tree.unit_count; id++)
+	{
+		uint64_t const bit = uint64_t(1) << (id % 64);
+		if((tree.real_masks[i * word_count + id / 64] & bit) == 0)
+		{
+			tree.values[i * tree.unit_count + id] = 0;
+		}
+	}
+}
+
+// The outcome of parsing the changed nodes again.
+enum class NodeUpdate
+{
+	DONE,
+	ERROR,
+	// The whole content must be parsed.
+	NOT_POSSIBLE
+};
+
+// Parse the changed nodes into the tree of the result, which holds the
+// previous calculation of a content with the same nodes, and calculate them
+// again with their ancestors. The changed nodes are in pre-order.
+NodeUpdate update_changed_nodes(
+	ParserResult & result, std::string_view content,
+	NodeContents const & contents, std::vector<size_t> const & changed_nodes
+)
+{
+	Tree & tree = result.tree;
+	size_t const word_count = tree.get_mask_word_count();
+
+	std::map<std::string, size_t, std::less<>> unit_ids;
+	for(size_t id = 0; id < result.unit_definitions.size(); id++)
+	{
+		unit_ids.emplace(result.unit_definitions[id].name, id);
+	}
+
+	std::vector<std::string> titles(changed_nodes.size());
+	bool has_title_changed = false;
+	// The nodes whose real units changed, and the units no longer real in
+	// one of them.
+	std::vector<size_t> redefined_nodes;
+	std::vector<uint64_t> removed_units(word_count, 0);
+	std::vector<uint64_t> previous_real_mask(word_count);
+	for(size_t k = 0; k < changed_nodes.size(); k++)
+	{
+		size_t const i = changed_nodes[k];
+		ChunkParser chunk(content, contents.starts[i], contents.get_end(content, i));
+		parse_chunk(chunk);
+		if(chunk.has_error)
+		{
+			result = create_ParserResult_error(chunk.error_message);
+			return NodeUpdate::ERROR;
+		}
+
+		std::vector<size_t> global_ids;
+		for(UnitDefinition const & unit_definition : chunk.unit_definitions)
+		{
+			auto const id_it = unit_ids.find(unit_definition.name);
+			if(id_it == unit_ids.end())
+			{
+				return NodeUpdate::NOT_POSSIBLE;
+			}
+			global_ids.push_back(id_it->second);
+		}
+
+		uint64_t * real_mask = tree.real_masks.data() + i * word_count;
+		std::copy(real_mask, real_mask + word_count, previous_real_mask.begin());
+		std::fill(real_mask, real_mask + word_count, 0);
+		for(ChunkUnit const & unit : chunk.units)
+		{
+			set_real_unit(tree, i, global_ids[unit.id], unit.value);
+		}
+		if(!std::equal(real_mask, real_mask + word_count, previous_real_mask.begin()))
+		{
+			redefined_nodes.push_back(i);
+			for(size_t w = 0; w < word_count; w++)
+			{
+				removed_units[w] |= previous_real_mask[w] & ~real_mask[w];
+			}
+		}
+
+		titles[k] = chunk.titles;
+		has_title_changed = (
+			has_title_changed || titles[k] != tree.get_view().get_title(i)
+		);
+	}
+
+	for(size_t w = 0; w < word_count; w++)
+	{
+		if(!are_units_defined(tree, w, removed_units[w]))
+		{
+			return NodeUpdate::NOT_POSSIBLE;
+		}
+	}
+
+	if(has_title_changed)
+	{
+		// The paths in the index are the previous ones.
+		result.index = TreeIndex();
+		std::string const previous_titles = std::move(tree.titles);
+		std::vector<size_t> const previous_title_offsets = tree.title_offsets;
+		tree.titles.clear();
+		tree.titles.reserve(previous_titles.size());
+		size_t k = 0;
+		for(size_t i = 0; i < tree.get_node_count(); i++)
+		{
+			tree.title_offsets[i] = tree.titles.size();
+			if(k < changed_nodes.size() && changed_nodes[k] == i)
+			{
+				tree.titles += titles[k];
+				k++;
+				continue;
+			}
+			size_t const end = (
+				i + 1 < tree.get_node_count() ?
+				previous_title_offsets[i + 1] : previous_titles.size()
+			);
+			tree.titles.append(
+				previous_titles, previous_title_offsets[i], end - previous_title_offsets[i]
+			);
+		}
+	}
+
+	// The ignored units of the descendants of a redefined node change. The
+	// redefined nodes in a subtree already updated are skipped.
+	size_t updated_end = 0;
+	for(size_t i : redefined_nodes)
+	{
+		if(i < updated_end)
+		{
+			continue;
+		}
+		updated_end = tree.subtree_ends[i];
+		for(size_t j = i + 1; j < updated_end; j++)
+		{
+			update_ignored_units(tree, j);
+		}
+	}
+
+	// The values of the other nodes only depend on their subtree, so only the
+	// changed nodes and their ancestors are calculated again, children first.
+	std::vector<bool> is_outdated(tree.get_node_count(), false);
+	std::vector<size_t> outdated_nodes;
+	for(size_t i : changed_nodes)
+	{
+		for(size_t j = i; !is_outdated[j]; j = tree.parents[j])
+		{
+			is_outdated[j] = true;
+			outdated_nodes.push_back(j);
+		}
+	}
+	std::sort(outdated_nodes.begin(), outdated_nodes.end(), std::greater<size_t>());
+	for(size_t i : outdated_nodes)
+	{
+		clear_calculated_units(tree, i);
+		sum_children_units(tree, i);
+	}
+	return NodeUpdate::DONE;
+}
+
+// The hash of the empty path, which is the path of the total node.
+constexpr uint64_t EMPTY_PATH_HASH = 0;
+
+// The hash of the path of a node from the one of the path of its parent.
+inline uint64_t hash_child_path(uint64_t parent_path_hash, std::string_view title)
+{
+	return mix_hash(parent_path_hash, hash_bytes(title));
+}
+
+// Whether the title of the node `i` is in the titles, after the one of the
+// previous node.
+bool is_title_correct(TreeView const & tree, size_t i) noexcept
+{
+	size_t const end = i + 1 < tree.node_count ? tree.title_offsets[i + 1] : tree.titles.size();
+	return tree.title_offsets[i] <= end && end <= tree.titles.size();
+}
+
+// Whether the node `child` is a child of `parent`, which is correct, so the
+// node can be walked from its parent or the parent from the node.
+bool is_child_link_correct(TreeView const & tree, size_t parent, size_t child) noexcept
+{
+	return (
+		parent < child &&
+		child < tree.subtree_ends[parent] &&
+		tree.parents[child] == parent &&
+		tree.subtree_ends[child] > child &&
+		tree.subtree_ends[child] <= tree.subtree_ends[parent] &&
+		tree.depths[child] == tree.depths[parent] + 1 &&
+		is_title_correct(tree, child)
+	);
+}
+
+bool is_total_node_correct(TreeView const & tree) noexcept
+{
+	return (
+		tree.node_count > 0 &&
+		tree.parents[0] == 0 &&
+		tree.subtree_ends[0] == tree.node_count &&
+		tree.depths[0] == 0 &&
+		is_title_correct(tree, 0)
+	);
+}
+
+bool lorg::is_subtree_correct(TreeView const & tree, size_t root) noexcept
+{
+	if(
+		root >= tree.node_count ||
+		tree.subtree_ends[root] <= root ||
+		tree.subtree_ends[root] > tree.node_count ||
+		!is_title_correct(tree, root)
+	)
+	{
+		return false;
+	}
+	// The nodes are checked in pre-order, each one against the deepest node
+	// whose subtree it is in, which must be its parent. The root holds all the
+	// nodes, so it is never left.
+	size_t const end = tree.subtree_ends[root];
+	size_t parent = root;
+	for(size_t i = root + 1; i < end; i++)
+	{
+		while(tree.subtree_ends[parent] <= i)
+		{
+			parent = tree.parents[parent];
+		}
+		if(!is_child_link_correct(tree, parent, i))
+		{
+			return false;
+		}
+		parent = i;
+	}
+	return true;
+}
+
+// Whether the path of the node `i` is made of `titles`, which tells the nodes
+// found by their path hash from the ones with the same hash. With
+// `check_links`, the links from the node to the total node are checked as
+// they are walked, and `is_correct` is set to false if one is not.
+bool is_node_path(
+	TreeView const & tree, size_t i, std::vector<std::string_view> const & titles,
+	bool check_links, bool & is_correct
+)
+{
+	if(check_links && !is_title_correct(tree, i))
+	{
+		is_correct = false;
+		return false;
+	}
+	if(tree.depths[i] != titles.size())
+	{
+		return false;
+	}
+	for(size_t k = titles.size(); k > 0; k--)
+	{
+		if(tree.get_title(i) != titles[k - 1])
+		{
+			return false;
+		}
+		size_t const parent = tree.parents[i];
+		if(check_links && !is_child_link_correct(tree, parent, i))
+		{
+			is_correct = false;
+			return false;
+		}
+		i = parent;
+	}
+	if(check_links && i != 0)
+	{
+		is_correct = false;
+		return false;
+	}
+	return true;
+}
+
+// Whether the pattern only matches the paths made of its titles.
+bool is_exact_path_pattern(PathPattern const & pattern)
+{
+	return std::all_of(
+		pattern.titles.begin(), pattern.titles.end(),
+		[](TitlePattern const & title)
+		{
+			return title.parts.size() == 1;
+		}
+	);
+}
+
+void index_paths(TreeView const & tree, TreeIndex & index)
+{
+	size_t const node_count = tree.node_count;
+	size_t const slot_mask = get_path_slot_count(node_count) - 1;
+	index.path_hashes.assign(slot_mask + 1, 0);
+	index.path_nodes.assign(slot_mask + 1, NO_NODE);
+
+	// The parents are before their children, so their paths are hashed
+	// first.
+	std::vector<uint64_t> node_path_hashes(node_count);
+	node_path_hashes[0] = EMPTY_PATH_HASH;
+	for(size_t i = 1; i < node_count; i++)
+	{
+		node_path_hashes[i] = hash_child_path(
+			node_path_hashes[tree.parents[i]], tree.get_title(i)
+		);
+	}
+	for(size_t i = 0; i < node_count; i++)
+	{
+		size_t slot = static_cast<size_t>(node_path_hashes[i]) & slot_mask;
+		while(index.path_nodes[slot] != NO_NODE)
+		{
+			slot = (slot + 1) & slot_mask;
+		}
+		index.path_hashes[slot] = node_path_hashes[i];
+		index.path_nodes[slot] = i;
+	}
+}
+
+void index_titles(TreeView const & tree, TreeIndex & index)
+{
+	// The nodes are already in pre-order, which the stable sort keeps for
+	// the same titles.
+	index.title_nodes.resize(tree.node_count - 1);
+	std::iota(index.title_nodes.begin(), index.title_nodes.end(), size_t(1));
+	std::stable_sort(
+		index.title_nodes.begin(), index.title_nodes.end(),
+		[&tree](size_t i, size_t j)
+		{
+			return tree.get_title(i) < tree.get_title(j);
+		}
+	);
+}
+
+// With a pool, the paths are added to the table while the titles are sorted.
+TreeIndex build_tree_index(TreeView const & tree, ThreadPool * pool)
+{
+	TreeIndex index;
+	index.node_count = tree.node_count;
+	if(tree.node_count == 0)
+	{
+		return index;
+	}
+	run_in_parallel(
+		pool, 2,
+		[&tree, &index](size_t task)
+		{
+			if(task == 0)
+			{
+				index_paths(tree, index);
+			}
+			else
+			{
+				index_titles(tree, index);
+			}
+		}
+	);
+	return index;
+}
+
+// Set the counters of the statistics from the parsed content and its tree.
+// The lines are counted like the parser does: the last one may not end with a
+// line feed.
+void count_parsed_content(Stats & stats, std::string_view content, TreeView const & tree)
+{
+	stats.byte_count = content.size();
+	stats.line_count = static_cast<uint64_t>(std::count(content.begin(), content.end(), '\n'));
+	if(!content.empty() && content.back() != '\n')
+	{
+		stats.line_count++;
+	}
+	stats.node_count = tree.node_count - 1;
+	stats.unit_count = 0;
+	for(size_t w = 0; w < tree.node_count * tree.get_mask_word_count(); w++)
+	{
+		stats.unit_count += std::bitset<64>(tree.real_masks[w]).count();
+	}
+	stats.peak_depth = 0;
+	for(size_t i = 0; i < tree.node_count; i++)
+	{
+		stats.peak_depth = std::max<uint64_t>(stats.peak_depth, tree.depths[i]);
+	}
+}
+
+// Merge the trees, see `lorg::merge_trees()`. Each tree is copied in
+// parallel to its own range of nodes, which starts with its total node.
+ParserResult merge_trees(std::vector<MergedTree> const & trees, ThreadPool * pool)
+{
+	ParserResult result;
+	result.has_error = false;
+
+	// The IDs of the units of each tree in the merged tree.
+	std::map<std::string, size_t, std::less<>> unit_ids;
+	std::vector<std::vector<size_t>> global_ids(trees.size());
+	for(size_t k = 0; k < trees.size(); k++)
+	{
+		for(UnitDefinition const & unit_definition : *trees[k].unit_definitions)
+		{
+			auto id_it = unit_ids.find(unit_definition.name);
+			if(id_it == unit_ids.end())
+			{
+				result.unit_definitions.push_back(unit_definition);
+				id_it = unit_ids.emplace(unit_definition.name, unit_ids.size()).first;
+			}
+			global_ids[k].push_back(id_it->second);
+		}
+	}
+
+	// The title of the total node of each tree is replaced by the title of
+	// the tree.
+	std::vector<size_t> node_starts(trees.size());
+	std::vector<size_t> title_starts(trees.size());
+	std::vector<size_t> total_title_ends(trees.size());
+	size_t node_count = 1;
+	size_t titles_size = TOTAL_NODE_TITLE.size();
+	for(size_t k = 0; k < trees.size(); k++)
+	{
+		TreeView const & tree = trees[k].tree;
+		node_starts[k] = node_count;
+		title_starts[k] = titles_size;
+		total_title_ends[k] = tree.node_count > 1 ? tree.title_offsets[1] : tree.titles.size();
+		node_count += tree.node_count;
+		titles_size += trees[k].title.size() + tree.titles.size() - total_title_ends[k];
+	}
+
+	Tree & merged = result.tree;
+	size_t const unit_count = result.unit_definitions.size();
+	merged.unit_count = unit_count;
+	size_t const word_count = merged.get_mask_word_count();
+	merged.parents.resize(node_count);
+	merged.subtree_ends.resize(node_count);
+	merged.depths.resize(node_count);
+	merged.titles.resize(titles_size);
+	merged.title_offsets.resize(node_count);
+	merged.values.assign(node_count * unit_count, UnitValue(0));
+	merged.real_masks.assign(node_count * word_count, 0);
+	merged.ignored_masks.assign(node_count * word_count, 0);
+
+	merged.parents[0] = 0;
+	merged.subtree_ends[0] = node_count;
+	merged.depths[0] = 0;
+	merged.title_offsets[0] = 0;
+	std::copy(TOTAL_NODE_TITLE.begin(), TOTAL_NODE_TITLE.end(), merged.titles.begin());
+
+	run_in_parallel(
+		pool, trees.size(),
+		[&](size_t k)
+		{
+			TreeView const & tree = trees[k].tree;
+			std::string_view const title = trees[k].title;
+			std::vector<size_t> const & ids = global_ids[k];
+			size_t const start = node_starts[k];
+			size_t const tree_word_count = tree.get_mask_word_count();
+
+			auto const title_it = merged.titles.begin() + static_cast<std::ptrdiff_t>(title_starts[k]);
+			std::copy(title.begin(), title.end(), title_it);
+			std::string_view const other_titles = tree.titles.substr(total_title_ends[k]);
+			std::copy(
+				other_titles.begin(), other_titles.end(),
+				title_it + static_cast<std::ptrdiff_t>(title.size())
+			);
+
+			for(size_t i = 0; i < tree.node_count; i++)
+			{
+				size_t const m = start + i;
+				merged.parents[m] = i == 0 ? 0 : start + tree.parents[i];
+				merged.subtree_ends[m] = start + tree.subtree_ends[i];
+				merged.depths[m] = tree.depths[i] + 1;
+				merged.title_offsets[m] = title_starts[k] + (
+					i == 0 ? 0 : title.size() + tree.title_offsets[i] - total_title_ends[k]
+				);
+
+				for(size_t u = 0; u < tree.unit_count; u++)
+				{
+					size_t const id = ids[u];
+					merged.values[m * unit_count + id] = tree.values[i * tree.unit_count + u];
+					size_t const word = i * tree_word_count + u / 64;
+					uint64_t const bit = uint64_t(1) << (u % 64);
+					size_t const merged_word = m * word_count + id / 64;
+					uint64_t const merged_bit = uint64_t(1) << (id % 64);
+					merged.real_masks[merged_word] |= (tree.real_masks[word] & bit) != 0 ? merged_bit : 0;
+					merged.ignored_masks[merged_word] |= (tree.ignored_masks[word] & bit) != 0 ? merged_bit : 0;
+				}
+			}
+		}
+	);
+
+	// The total node sums the nodes of level 1 like the other nodes sum their
+	// children. None of its units is real.
+	std::vector<UnitValue> compensations(unit_count, UnitValue(0));
+	std::vector<uint64_t> const real_mask(word_count, 0);
+	for(size_t k = 0; k < trees.size(); k++)
+	{
+		add_child_units<UnitValues>(
+			merged.values.data(), compensations.data(),
+			merged.values.data() + node_starts[k] * unit_count, real_mask.data(), unit_count
+		);
+	}
+	finish_child_units<UnitValues>(
+		merged.values.data(), compensations.data(), real_mask.data(), unit_count
+	);
+	return result;
+}
+
+std::unique_ptr<ThreadPool> create_thread_pool(size_t jobs)
+{
+	if(jobs <= 1)
+	{
+		return nullptr;
+	}
+	return std::make_unique<ThreadPool>(jobs);
+}
+
+ParserResult lorg::convert_string_to_nodes(
+	std::string_view content, ParserOptions const & options
+)
+{
+	std::unique_ptr<ThreadPool> pool = create_thread_pool(options.jobs);
+	ParserResult result;
+	{
+		ScopedTimer timer(options.stats, "parse");
+		result = ::convert_string_to_nodes(content, pool.get());
+	}
+	if(result.has_error)
+	{
+		return result;
+	}
+	if(options.build_index)
+	{
+		ScopedTimer timer(options.stats, "index");
+		result.index = ::build_tree_index(result.tree.get_view(), pool.get());
+	}
+	if(ARE_STATS_ENABLED && options.stats != nullptr)
+	{
+		count_parsed_content(*options.stats, content, result.tree.get_view());
+	}
+	return result;
+}
+
+void lorg::update_node_unit_values(
+	ParserResult & result, ParserOptions const & options
+)
+{
+	std::unique_ptr<ThreadPool> pool = create_thread_pool(options.jobs);
+	ScopedTimer timer(options.stats, "calculate");
+	::update_node_unit_values(result, pool.get());
+}
+
+ParserResult lorg::parse(std::string_view content, ParserOptions const & options)
+{
+	std::unique_ptr<ThreadPool> pool = create_thread_pool(options.jobs);
+	return parse(content, pool.get(), options);
+}
+
+ParserResult lorg::parse(
+	std::string_view content, ThreadPool * pool, ParserOptions const & options
+)
+{
+	ParserResult result;
+	{
+		ScopedTimer timer(options.stats, "parse");
+		result = ::convert_string_to_nodes(content, pool);
+	}
+	if(result.has_error)
+	{
+		return result;
+	}
+	if(options.build_index)
+	{
+		ScopedTimer timer(options.stats, "index");
+		result.index = ::build_tree_index(result.tree.get_view(), pool);
+	}
+	{
+		ScopedTimer timer(options.stats, "calculate");
+		::update_node_unit_values(result, pool);
+	}
+	if(ARE_STATS_ENABLED && options.stats != nullptr)
+	{
+		count_parsed_content(*options.stats, content, result.tree.get_view());
+	}
+	return result;
+}
+
+TreeIndex lorg::build_tree_index(TreeView const & tree, ParserOptions const & options)
+{
+	std::unique_ptr<ThreadPool> pool = create_thread_pool(options.jobs);
+	ScopedTimer timer(options.stats, "index");
+	return ::build_tree_index(tree, pool.get());
+}
+
+ParserResult lorg::merge_trees(
+	std::vector<MergedTree> const & trees, ParserOptions const & options
+)
+{
+	std::unique_ptr<ThreadPool> pool = create_thread_pool(options.jobs);
+	return merge_trees(trees, pool.get(), options);
+}
+
+ParserResult lorg::merge_trees(
+	std::vector<MergedTree> const & trees, ThreadPool * pool, ParserOptions const & options
+)
+{
+	ScopedTimer timer(options.stats, "merge");
+	return ::merge_trees(trees, pool);
+}
+
+TreeIndex lorg::copy_tree_index(TreeIndexView const & view)
+{
+	TreeIndex index;
+	index.node_count = view.node_count;
+	if(view.is_empty())
+	{
+		return index;
+	}
+	size_t const slot_count = view.path_slot_count;
+	index.path_hashes.assign(view.path_hashes, view.path_hashes + slot_count);
+	index.path_nodes.assign(view.path_nodes, view.path_nodes + slot_count);
+	index.title_nodes.assign(view.title_nodes, view.title_nodes + view.node_count - 1);
+	return index;
+}
+
+// With `check_links`, the slots of the path table and the links walked are
+// checked, and `is_correct` is set to false if one is not.
+std::vector<size_t> find_nodes_by_path(
+	TreeView const & tree, TreeIndexView const & index,
+	std::vector<std::string_view> const & titles, bool check_links, bool & is_correct
+)
+{
+	uint64_t path_hash = EMPTY_PATH_HASH;
+	for(std::string_view title : titles)
+	{
+		path_hash = hash_child_path(path_hash, title);
+	}
+
+	std::vector<size_t> nodes;
+	if(index.is_empty())
+	{
+		return nodes;
+	}
+	size_t const slot_mask = index.path_slot_count - 1;
+	size_t slot = static_cast<size_t>(path_hash) & slot_mask;
+	for(size_t k = 0; index.path_nodes[slot] != NO_NODE; k++)
+	{
+		// A correct table always has empty slots.
+		size_t const i = index.path_nodes[slot];
+		if(check_links && (k == index.path_slot_count || i >= tree.node_count))
+		{
+			is_correct = false;
+			return nodes;
+		}
+		if(
+			index.path_hashes[slot] == path_hash &&
+			is_node_path(tree, i, titles, check_links, is_correct)
+		)
+		{
+			nodes.push_back(i);
+		}
+		if(!is_correct)
+		{
+			return nodes;
+		}
+		slot = (slot + 1) & slot_mask;
+	}
+	return nodes;
+}
+
+std::vector<size_t> lorg::find_nodes_by_path(
+	TreeView const & tree, TreeIndexView const & index,
+	std::vector<std::string_view> const & titles
+)
+{
+	bool is_correct = true;
+	return ::find_nodes_by_path(tree, index, titles, false, is_correct);
+}
+
+std::vector<size_t> lorg::find_nodes_by_title_prefix(
+	TreeView const & tree, TreeIndexView const & index, std::string_view prefix
+)
+{
+	// The titles starting with the prefix follow each other from the first
+	// title not before it.
+	std::vector<size_t> nodes;
+	if(index.is_empty())
+	{
+		return nodes;
+	}
+	size_t const * const title_nodes_end = index.title_nodes + index.node_count - 1;
+	for(
+		size_t const * it = std::lower_bound(
+			index.title_nodes, title_nodes_end, prefix,
+			[&tree](size_t i, std::string_view value)
+			{
+				return tree.get_title(i) < value;
+			}
+		);
+		it != title_nodes_end && tree.get_title(*it).substr(0, prefix.size()) == prefix;
+		it++
+	)
+	{
+		nodes.push_back(*it);
+	}
+	return nodes;
+}
+
+PathPattern lorg::read_path_pattern(std::string_view pattern)
+{
+	PathPattern path_pattern;
+	if(pattern.empty())
+	{
+		return path_pattern;
+	}
+	path_pattern.titles.emplace_back();
+	path_pattern.titles.back().parts.emplace_back();
+	for(size_t i = 0; i < pattern.size(); i++)
+	{
+		char c = pattern[i];
+		TitlePattern & title = path_pattern.titles.back();
+		if(c == NODE_PATH_SEPARATOR)
+		{
+			path_pattern.titles.emplace_back();
+			path_pattern.titles.back().parts.emplace_back();
+			continue;
+		}
+		if(c == PATH_PATTERN_WILDCARD)
+		{
+			title.parts.emplace_back();
+			continue;
+		}
+		if(c == PATH_PATTERN_ESCAPE && i + 1 < pattern.size())
+		{
+			i++;
+			c = pattern[i];
+		}
+		title.parts.back().push_back(c);
+	}
+	return path_pattern;
+}
+
+bool lorg::is_path_pattern_correct(PathPattern const & pattern) noexcept
+{
+	return std::none_of(
+		pattern.titles.begin(), pattern.titles.end(),
+		[](TitlePattern const & title)
+		{
+			return title.parts.size() == 1 && title.parts.front().empty();
+		}
+	);
+}
+
+bool lorg::does_title_match(TitlePattern const & pattern, std::string_view title)
+{
+	std::vector<std::string> const & parts = pattern.parts;
+	if(parts.size() == 1)
+	{
+		return title == parts.front();
+	}
+
+	// The first and the last parts are at the ends of the title, the other
+	// ones are found in order between them. Finding each part at its first
+	// occurrence leaves the most room to the next ones.
+	std::string_view const first = parts.front();
+	std::string_view const last = parts.back();
+	if(
+		title.size() < first.size() + last.size() ||
+		title.substr(0, first.size()) != first ||
+		title.substr(title.size() - last.size()) != last
+	)
+	{
+		return false;
+	}
+	std::string_view middle = title.substr(
+		first.size(), title.size() - first.size() - last.size()
+	);
+	for(size_t k = 1; k + 1 < parts.size(); k++)
+	{
+		size_t const position = middle.find(parts[k]);
+		if(position == std::string_view::npos)
+		{
+			return false;
+		}
+		middle.remove_prefix(position + parts[k].size());
+	}
+	return true;
+}
+
+// With `check_links`, the links walked to find the nodes and the subtrees of
+// the nodes found are checked, and `is_correct` is set to false if one is not.
+std::vector<size_t> select_nodes(
+	TreeView const & tree, std::vector<PathPattern> const & patterns,
+	TreeIndexView const & index, bool check_links, bool & is_correct
+)
+{
+	if(check_links && !is_total_node_correct(tree))
+	{
+		is_correct = false;
+		return std::vector<size_t>();
+	}
+
+	// A node to visit, with the patterns matching its path so far.
+	struct Candidate
+	{
+		size_t node;
+		std::vector<size_t> patterns;
+	};
+
+	std::vector<size_t> selected_nodes;
+	std::vector<Candidate> candidates(1);
+	candidates[0].node = 0;
+	for(size_t p = 0; p < patterns.size(); p++)
+	{
+		if(index.is_empty() || !is_exact_path_pattern(patterns[p]))
+		{
+			candidates[0].patterns.push_back(p);
+			continue;
+		}
+		std::vector<std::string_view> titles;
+		for(TitlePattern const & title : patterns[p].titles)
+		{
+			titles.push_back(title.parts.front());
+		}
+		std::vector<size_t> const nodes = ::find_nodes_by_path(
+			tree, index, titles, check_links, is_correct
+		);
+		if(!is_correct)
+		{
+			return std::vector<size_t>();
+		}
+		selected_nodes.insert(selected_nodes.end(), nodes.begin(), nodes.end());
+	}
+	if(candidates[0].patterns.empty())
+	{
+		candidates.clear();
+	}
+	while(!candidates.empty())
+	{
+		Candidate const candidate = std::move(candidates.back());
+		candidates.pop_back();
+
+		// The subtree of a selected node is not visited.
+		size_t const depth = tree.depths[candidate.node];
+		bool const is_selected = std::any_of(
+			candidate.patterns.begin(), candidate.patterns.end(),
+			[&patterns, depth](size_t p)
+			{
+				return patterns[p].titles.size() == depth;
+			}
+		);
+		if(is_selected)
+		{
+			selected_nodes.push_back(candidate.node);
+			continue;
+		}
+
+		size_t const end = tree.subtree_ends[candidate.node];
+		for(size_t child = candidate.node + 1; child < end; child = tree.subtree_ends[child])
+		{
+			if(check_links && !is_child_link_correct(tree, candidate.node, child))
+			{
+				is_correct = false;
+				return std::vector<size_t>();
+			}
+			Candidate child_candidate;
+			child_candidate.node = child;
+			for(size_t p : candidate.patterns)
+			{
+				std::vector<TitlePattern> const & titles = patterns[p].titles;
+				if(titles.size() > depth && does_title_match(titles[depth], tree.get_title(child)))
+				{
+					child_candidate.patterns.push_back(p);
+				}
+			}
+			if(!child_candidate.patterns.empty())
+			{
+				candidates.push_back(std::move(child_candidate));
+			}
+		}
+	}
+	std::sort(selected_nodes.begin(), selected_nodes.end());
+	if(check_links)
+	{
+		is_correct = std::all_of(
+			selected_nodes.begin(), selected_nodes.end(),
+			[&tree](size_t i) { return is_subtree_correct(tree, i); }
+		);
+		if(!is_correct)
+		{
+			return std::vector<size_t>();
+		}
+	}
+
+	// The nodes found in the index can be in the subtree of another selected
+	// node, or selected by several patterns.
+	size_t selected_count = 0;
+	size_t selected_end = 0;
+	for(size_t i : selected_nodes)
+	{
+		if(selected_count == 0 || i >= selected_end)
+		{
+			selected_nodes[selected_count] = i;
+			selected_count++;
+			selected_end = tree.subtree_ends[i];
+		}
+	}
+	selected_nodes.resize(selected_count);
+	return selected_nodes;
+}
+
+std::vector<size_t> lorg::select_nodes(
+	TreeView const & tree, std::vector<PathPattern> const & patterns,
+	TreeIndexView const & index
+)
+{
+	bool is_correct = true;
+	return ::select_nodes(tree, patterns, index, false, is_correct);
+}
+
+bool lorg::select_nodes_checked(
+	TreeView const & tree, std::vector<PathPattern> const & patterns,
+	TreeIndexView const & index, std::vector<size_t> & nodes
+)
+{
+	bool is_correct = true;
+	nodes = ::select_nodes(tree, patterns, index, true, is_correct);
+	return is_correct;
+}
+
+Tree lorg::copy_tree(TreeView const & view)
+{
+	size_t const node_count = view.node_count;
+	size_t const mask_size = node_count * view.get_mask_word_count();
+	Tree tree;
+	tree.parents.assign(view.parents, view.parents + node_count);
+	tree.subtree_ends.assign(view.subtree_ends, view.subtree_ends + node_count);
+	tree.depths.assign(view.depths, view.depths + node_count);
+	tree.titles = view.titles;
+	tree.title_offsets.assign(view.title_offsets, view.title_offsets + node_count);
+	tree.unit_count = view.unit_count;
+	tree.values.assign(view.values, view.values + node_count * view.unit_count);
+	tree.real_masks.assign(view.real_masks, view.real_masks + mask_size);
+	tree.ignored_masks.assign(view.ignored_masks, view.ignored_masks + mask_size);
+	return tree;
+}
+
+std::vector<uint64_t> lorg::hash_node_contents(std::string_view content)
+{
+	return ::hash_node_contents(content, split_into_node_contents(content));
+}
+
+ParserResult lorg::parse_incrementally(
+	std::string_view content, ParserResult previous,
+	uint64_t const * previous_node_hashes, std::vector<uint64_t> & node_hashes,
+	ParserOptions const & options
+)
+{
+	NodeContents contents;
+	{
+		ScopedTimer timer(options.stats, "hash");
+		contents = split_into_node_contents(content);
+		node_hashes = ::hash_node_contents(content, contents);
+	}
+
+	// The nodes keep their parents only if they keep their levels.
+	size_t const node_count = node_hashes.size();
+	Tree const & previous_tree = previous.tree;
+	bool is_possible = (
+		previous_node_hashes != nullptr &&
+		!previous.has_error &&
+		previous_tree.get_node_count() == node_count &&
+		previous_node_hashes[0] == node_hashes[0]
+	);
+	std::vector<size_t> changed_nodes;
+	for(size_t i = 1; is_possible && i < node_count; i++)
+	{
+		is_possible = contents.levels[i] == previous_tree.depths[i];
+		if(node_hashes[i] != previous_node_hashes[i])
+		{
+			changed_nodes.push_back(i);
+		}
+	}
+	if(!is_possible)
+	{
+		return parse(content, options);
+	}
+
+	// The nodes created from the previous tree are released.
+	ParserResult result;
+	result.has_error = false;
+	result.unit_definitions = std::move(previous.unit_definitions);
+	result.tree = std::move(previous.tree);
+	result.index = std::move(previous.index);
+	NodeUpdate update = NodeUpdate::DONE;
+	if(!changed_nodes.empty())
+	{
+		ScopedTimer timer(options.stats, "update");
+		update = update_changed_nodes(result, content, contents, changed_nodes);
+	}
+	if(update == NodeUpdate::NOT_POSSIBLE)
+	{
+		return parse(content, options);
+	}
+	if(
+		!result.has_error && options.build_index &&
+		result.index.node_count != node_count
+	)
+	{
+		result.index = build_tree_index(result.tree.get_view(), options);
+	}
+	if(ARE_STATS_ENABLED && options.stats != nullptr && !result.has_error)
+	{
+		count_parsed_content(*options.stats, content, result.tree.get_view());
+	}
+	return result;
+}
+
+Node * lorg::create_node_tree(ParserResult & result)
+{
+	Tree const & tree = result.tree;
+	TreeView const tree_view = tree.get_view();
+	Arena & arena = result.arena;
+	size_t const node_count = tree.get_node_count();
+	if(node_count == 0)
+	{
+		return nullptr;
+	}
+
+	std::vector<Node *> nodes(node_count);
+	std::vector<size_t> child_counts(node_count, 0);
+	for(size_t i = 0; i < node_count; i++)
+	{
+		Node * node = arena.create<Node>();
+		node->title = arena.copy(tree_view.get_title(i));
+
+		Unit * units = arena.allocate_array<Unit>(tree.unit_count);
+		for(size_t id = 0; id < tree.unit_count; id++)
+		{
+			units[id] = tree_view.get_unit(i, id);
+		}
+		node->units.assign(units, tree.unit_count);
+
+		nodes[i] = node;
+		if(i > 0)
+		{
+			child_counts[tree.parents[i]]++;
+		}
+	}
+	for(size_t i = 0; i < node_count; i++)
+	{
+		nodes[i]->children.reserve(arena, child_counts[i]);
+	}
+	for(size_t i = 1; i < node_count; i++)
+	{
+		nodes[tree.parents[i]]->children.push_back(arena, nodes[i]);
+	}
+	return nodes[0];
+}
+
+// A node being parsed by `parse_stream()`.
+struct OpenNode
+{
+	size_t index;
+	std::string title;
+
+	// The units of the node, indexed by unit ID. The closed children are
+	// added to the calculated ones. The row only grows up to the highest
+	// unit ID found in the subtree so far.
+	std::vector<Unit> units;
+	// The compensations of the calculated units, only used by the
+	// compensated backends. There are as many as units.
+	std::vector<UnitValue> compensations;
+
+	// Whether the node is selected or in the subtree of a selected node.
+	// Only those nodes are written and calculated.
+	bool is_selected;
+	// The index of the node among the selected ones, in pre-order.
+	size_t selected_index;
+	// When the node is not selected, the selection patterns whose titles
+	// match its path so far.
+	std::vector<size_t> matching_patterns;
+};
+
+// The calculated nodes are written in the order they are closed to
+// `records`. The offset of the record of the selected node `k` is at `k` in
+// `offsets`. A record is a `RecordHeader`, the title, then the units.
+struct RecordHeader
+{
+	uint64_t index;
+	uint64_t depth;
+	uint64_t subtree_end;
+	uint64_t title_size;
+	uint64_t unit_count;
+};
+
+struct StreamParser
+{
+	std::FILE * records;
+	std::FILE * offsets;
+	// The size written to `records`, which is where the next record starts.
+	uint64_t records_size;
+
+	// The node `k` is at the depth `k`, the total node at the bottom. Only
+	// the first `open_node_count` are open, the others are kept so the next
+	// nodes reuse their memory: once the deepest branch is parsed, the nodes
+	// allocate nothing.
+	std::vector<OpenNode> open_nodes;
+	size_t open_node_count;
+	size_t node_count;
+
+	std::vector<PathPattern> const & selection;
+	size_t selected_count;
+
+	bool has_error;
+	std::string error_message;
+	int line_number;
+
+	// Only counted for the statistics.
+	size_t real_unit_count;
+	size_t peak_depth;
+
+	std::vector<UnitDefinition> unit_definitions;
+	std::map<std::string, size_t, std::less<>> unit_ids;
+
+	// The offsets written consecutively are kept to be written at once,
+	// starting with the one of the node `first_pending_offset`, up to
+	// `MAX_PENDING_OFFSET_COUNT` of them.
+	std::vector<uint64_t> pending_offsets;
+	size_t first_pending_offset;
+
+	// Used to remove the ignored characters from a line.
+	std::string line_buffer;
+
+	explicit StreamParser(std::vector<PathPattern> const & selection):
+		records(std::tmpfile()),
+		offsets(std::tmpfile()),
+		records_size(0),
+		open_node_count(1),
+		node_count(1),
+		selection(selection),
+		selected_count(0),
+		has_error(false),
+		line_number(0),
+		real_unit_count(0),
+		peak_depth(0),
+		first_pending_offset(0)
+	{
+		// Without selection, the whole tree is selected.
+		open_nodes.emplace_back();
+		OpenNode & total_node = open_nodes.back();
+		total_node.index = 0;
+		total_node.title = TOTAL_NODE_TITLE;
+		total_node.is_selected = selection.empty();
+		for(size_t p = 0; p < selection.size(); p++)
+		{
+			total_node.is_selected = (
+				total_node.is_selected || selection[p].titles.empty()
+			);
+			total_node.matching_patterns.push_back(p);
+		}
+		if(total_node.is_selected)
+		{
+			total_node.matching_patterns.clear();
+			total_node.selected_index = selected_count;
+			selected_count++;
+		}
+	}
+
+	StreamParser(StreamParser const &) = delete;
+	StreamParser & operator=(StreamParser const &) = delete;
+
+	~StreamParser()
+	{
+		// The temporary files are removed when they are closed.
+		if(records != nullptr)
+		{
+			std::fclose(records);
+		}
+		if(offsets != nullptr)
+		{
+			std::fclose(offsets);
+		}
+	}
+};
+
+void set_error(StreamParser & parser, std::string error_message)
+{
+	parser.has_error = true;
+	parser.error_message = error_message;
+}
+
+std::string get_error_message_temporary_files()
+{
+	return "The temporary files needed to stream the content cannot be written.";
+}
+
+// Move to `position` in the file. Unlike `std::fseek()`, the position is not
+// limited by `long`, which is 32 bits on some systems, so the temporary files
+// of `parse_stream()` can grow beyond 2 GiB.
+bool seek_file(std::FILE * file, uint64_t position)
+{
+#if defined(_WIN32)
+	return (
+		position <= static_cast<uint64_t>(INT64_MAX) &&
+		_fseeki64(file, static_cast<__int64>(position), SEEK_SET) == 0
+	);
+#elif IS_POSIX
+	off_t const offset = static_cast<off_t>(position);
+	return (
+		offset >= 0 && static_cast<uint64_t>(offset) == position &&
+		fseeko(file, offset, SEEK_SET) == 0
+	);
+#else
+	return (
+		position <= static_cast<uint64_t>(LONG_MAX) &&
+		std::fseek(file, static_cast<long>(position), SEEK_SET) == 0
+	);
+#endif
+}
+
+bool flush_pending_offsets(StreamParser & parser)
+{
+	if(parser.pending_offsets.empty())
+	{
+		return true;
+	}
+	uint64_t const position = static_cast<uint64_t>(parser.first_pending_offset) * sizeof(uint64_t);
+	size_t const count = parser.pending_offsets.size();
+	bool const is_written = (
+		seek_file(parser.offsets, position) &&
+		std::fwrite(parser.pending_offsets.data(), sizeof(uint64_t), count, parser.offsets) == count
+	);
+	parser.first_pending_offset += count;
+	parser.pending_offsets.clear();
+	return is_written;
+}
+
+bool write_offset(StreamParser & parser, size_t index, uint64_t offset)
+{
+	// The nodes without children are closed in the order they are defined,
+	// so most offsets follow the previous one.
+	if(index != parser.first_pending_offset + parser.pending_offsets.size())
+	{
+		if(!flush_pending_offsets(parser))
+		{
+			return false;
+		}
+		parser.first_pending_offset = index;
+	}
+	parser.pending_offsets.push_back(offset);
+	return (
+		parser.pending_offsets.size() < MAX_PENDING_OFFSET_COUNT ||
+		flush_pending_offsets(parser)
+	);
+}
+
+// Add the units of a closed node to the calculated units of its parent.
+template<typename Values>
+void add_closed_child_units(OpenNode & parent, OpenNode const & child)
+{
+	if(parent.units.size() < child.units.size())
+	{
+		parent.units.resize(child.units.size(), Unit{0, false, false});
+	}
+	if constexpr(Values::IS_COMPENSATED)
+	{
+		parent.compensations.resize(parent.units.size(), 0);
+	}
+	for(size_t id = 0; id < child.units.size(); id++)
+	{
+		Unit & unit = parent.units[id];
+		if(unit.is_real)
+		{
+			continue;
+		}
+		if constexpr(Values::IS_COMPENSATED)
+		{
+			Values::add(unit.value, parent.compensations[id], child.units[id].value);
+		}
+		else
+		{
+			Values::add(unit.value, child.units[id].value);
+		}
+	}
+}
+
+// Correct the calculated units of a node by their compensations once all its
+// children are added.
+template<typename Values>
+void finish_calculated_units(OpenNode & node)
+{
+	if constexpr(Values::IS_COMPENSATED)
+	{
+		for(size_t id = 0; id < node.compensations.size(); id++)
+		{
+			Unit & unit = node.units[id];
+			if(!unit.is_real)
+			{
+				unit.value = Values::finish(unit.value, node.compensations[id]);
+			}
+		}
+	}
+}
+
+// Open a node on top of the open nodes, reusing the memory of the last node
+// closed at this depth.
+OpenNode & push_open_node(StreamParser & parser)
+{
+	if(parser.open_node_count == parser.open_nodes.size())
+	{
+		parser.open_nodes.emplace_back();
+	}
+	OpenNode & node = parser.open_nodes[parser.open_node_count];
+	parser.open_node_count++;
+	node.title.clear();
+	node.units.clear();
+	node.compensations.clear();
+	node.matching_patterns.clear();
+	return node;
+}
+
+// Write the node on top of the open nodes and add its units to its parent.
+// The nodes outside of the selection are neither written nor calculated,
+// their values would only be added to other nodes outside of it.
+void close_node(StreamParser & parser)
+{
+	OpenNode & node = parser.open_nodes[parser.open_node_count - 1];
+	if(!node.is_selected)
+	{
+		parser.open_node_count--;
+		return;
+	}
+	finish_calculated_units<UnitValues>(node);
+
+	RecordHeader header;
+	header.index = node.index;
+	header.depth = parser.open_node_count - 1;
+	header.subtree_end = parser.node_count;
+	header.title_size = node.title.size();
+	header.unit_count = node.units.size();
+	uint64_t const offset = parser.records_size;
+	bool is_written = (
+		std::fwrite(&header, sizeof(header), 1, parser.records) == 1 &&
+		std::fwrite(node.title.data(), 1, node.title.size(), parser.records) == node.title.size() &&
+		std::fwrite(node.units.data(), sizeof(Unit), node.units.size(), parser.records) == node.units.size() &&
+		write_offset(parser, node.selected_index, offset)
+	);
+	parser.records_size += sizeof(header) + node.title.size() + node.units.size() * sizeof(Unit);
+	if(!is_written)
+	{
+		set_error(parser, get_error_message_temporary_files());
+		return;
+	}
+
+	if(parser.open_node_count > 1 && parser.open_nodes[parser.open_node_count - 2].is_selected)
+	{
+		OpenNode & parent = parser.open_nodes[parser.open_node_count - 2];
+		add_closed_child_units<UnitValues>(parent, node);
+	}
+	parser.open_node_count--;
+}
+
+void parse_stream_node_definition(StreamParser & parser, std::string_view line)
+{
+	NodeDefinition const definition = read_node_definition(line);
+	if(definition.title.empty())
+	{
+		set_error(parser, get_error_message_node_without_title(parser.line_number));
+		return;
+	}
+	if(definition.level > parser.open_node_count)
+	{
+		set_error(
+			parser, get_error_message_node_without_direct_parent(parser.line_number)
+		);
+		return;
+	}
+
+	while(parser.open_node_count > definition.level && !parser.has_error)
+	{
+		close_node(parser);
+	}
+
+	// The units real or ignored in the parent are ignored. The parent has
+	// all its units, they are defined before its children.
+	OpenNode & node = push_open_node(parser);
+	OpenNode const & parent = parser.open_nodes[parser.open_node_count - 2];
+	node.index = parser.node_count;
+	node.title.assign(definition.title);
+	node.units.resize(parent.units.size());
+	for(size_t id = 0; id < parent.units.size(); id++)
+	{
+		Unit const & parent_unit = parent.units[id];
+		node.units[id] = Unit{0, false, parent_unit.is_ignored || parent_unit.is_real};
+	}
+
+	// The node is selected when its path matches a whole pattern. Its
+	// descendants can only be when it matches the start of one.
+	node.is_selected = parent.is_selected;
+	for(size_t p : parent.matching_patterns)
+	{
+		std::vector<TitlePattern> const & titles = parser.selection[p].titles;
+		if(does_title_match(titles[definition.level - 1], node.title))
+		{
+			node.is_selected = node.is_selected || titles.size() == definition.level;
+			node.matching_patterns.push_back(p);
+		}
+	}
+	if(node.is_selected)
+	{
+		node.matching_patterns.clear();
+		node.selected_index = parser.selected_count;
+		parser.selected_count++;
+	}
+	parser.node_count++;
+	if constexpr(ARE_STATS_ENABLED)
+	{
+		parser.peak_depth = std::max(parser.peak_depth, definition.level);
+	}
+}
+
+void parse_stream_unit_definition(StreamParser & parser, std::string_view line)
+{
+	std::string_view name;
+	UnitValue value;
+	UnitDefinitionStatus const status = read_unit_definition(line, name, value);
+	if(status != UnitDefinitionStatus::OK)
+	{
+		set_error(
+			parser,
+			status == UnitDefinitionStatus::ILL_FORMED ?
+			get_error_message_unit_definition_ill_formed(parser.line_number) :
+			get_error_message_unit_value_incorrect(parser.line_number)
+		);
+		return;
+	}
+	if(parser.open_node_count == 1)
+	{
+		set_error(parser, get_error_message_unit_outside_node(parser.line_number));
+		return;
+	}
+
+	auto id_it = parser.unit_ids.find(name);
+	if(id_it == parser.unit_ids.end())
+	{
+		UnitDefinition unit_definition;
+		unit_definition.name = name;
+		parser.unit_definitions.push_back(unit_definition);
+		id_it = parser.unit_ids.emplace(name, parser.unit_ids.size()).first;
+	}
+	size_t const unit_id = id_it->second;
+
+	std::vector<Unit> & units = parser.open_nodes[parser.open_node_count - 1].units;
+	if(units.size() <= unit_id)
+	{
+		units.resize(unit_id + 1, Unit{0, false, false});
+	}
+	if constexpr(ARE_STATS_ENABLED)
+	{
+		parser.real_unit_count += units[unit_id].is_real ? 0 : 1;
+	}
+	units[unit_id].value = value;
+	units[unit_id].is_real = true;
+}
+
+void parse_stream_line(StreamParser & parser, std::string_view line)
+{
+	parser.line_number++;
+	line = get_definition(line, parser.line_buffer);
+	if(line.empty())
+	{
+		return;
+	}
+	if(line[0] == NODE_DEFINITION_CHARACTER)
+	{
+		parse_stream_node_definition(parser, line);
+	}
+	else
+	{
+		parse_stream_unit_definition(parser, line);
+	}
+}
+
+// Read the records in pre-order and give them to `handle_node`.
+bool read_records(
+	StreamParser & parser, std::function<void(StreamedNode const &)> const & handle_node
+)
+{
+	if(!flush_pending_offsets(parser) || !seek_file(parser.offsets, 0))
+	{
+		return false;
+	}
+
+	// The subtree ends of the ancestors of the node up to its selected
+	// ancestor not in the subtree of another.
+	std::vector<size_t> subtree_ends;
+	size_t root_depth = 0;
+
+	std::string title;
+	std::vector<Unit> units;
+	for(size_t k = 0; k < parser.selected_count; k++)
+	{
+		uint64_t offset;
+		RecordHeader header;
+		if(
+			std::fread(&offset, sizeof(offset), 1, parser.offsets) != 1 ||
+			!seek_file(parser.records, offset) ||
+			std::fread(&header, sizeof(header), 1, parser.records) != 1
+		)
+		{
+			return false;
+		}
+
+		title.resize(header.title_size);
+		units.assign(parser.unit_definitions.size(), Unit{0, false, false});
+		if(
+			std::fread(&title[0], 1, title.size(), parser.records) != title.size() ||
+			std::fread(units.data(), sizeof(Unit), header.unit_count, parser.records) != header.unit_count
+		)
+		{
+			return false;
+		}
+
+		// The selected nodes of a subtree are consecutive, so another subtree
+		// follows if there are more selected nodes than in the subtree.
+		size_t const index = static_cast<size_t>(header.index);
+		size_t const depth = static_cast<size_t>(header.depth);
+		size_t const subtree_end = static_cast<size_t>(header.subtree_end);
+		bool has_next_sibling;
+		if(subtree_ends.empty() || index >= subtree_ends.front())
+		{
+			root_depth = depth;
+			subtree_ends.clear();
+			has_next_sibling = k + (subtree_end - index) < parser.selected_count;
+		}
+		else
+		{
+			subtree_ends.resize(depth - root_depth);
+			has_next_sibling = subtree_end < subtree_ends.back();
+		}
+		subtree_ends.push_back(subtree_end);
+
+		StreamedNode const node = {index, depth, subtree_end, has_next_sibling, title, units};
+		handle_node(node);
+	}
+	return true;
+}
+
+ParserResult lorg::parse_stream(
+	std::FILE * input,
+	std::function<void(std::vector<UnitDefinition> const &)> const & handle_unit_definitions,
+	std::function<void(StreamedNode const &)> const & handle_node,
+	std::vector<PathPattern> const & selection, Stats * stats
+)
+{
+	StreamParser parser(selection);
+	if(parser.records == nullptr || parser.offsets == nullptr)
+	{
+		return create_ParserResult_error(get_error_message_temporary_files());
+	}
+
+	// The content is read by blocks. The last line of a block is kept until
+	// the next block completes it.
+	std::optional<ScopedTimer> timer;
+	timer.emplace(stats, "parse");
+	uint64_t byte_count = 0;
+	// The buffer holds a block and the start of a line from the previous
+	// one, so it only grows for the lines longer than a block.
+	std::string buffer;
+	buffer.reserve(2 * STREAM_BLOCK_SIZE);
+	std::vector<char> block(STREAM_BLOCK_SIZE);
+	while(!parser.has_error)
+	{
+		size_t const read_size = std::fread(block.data(), 1, block.size(), input);
+		if(read_size == 0)
+		{
+			break;
+		}
+		byte_count += read_size;
+		buffer.append(block.data(), read_size);
+
+		std::string_view const content = buffer;
+		size_t line_start = 0;
+		while(!parser.has_error)
+		{
+			size_t const line_end = find_end_of_line(content, line_start);
+			if(line_end == content.size())
+			{
+				break;
+			}
+			parse_stream_line(parser, content.substr(line_start, line_end - line_start));
+			line_start = line_end + 1;
+		}
+		buffer.erase(0, line_start);
+	}
+	if(!parser.has_error && std::ferror(input) != 0)
+	{
+		set_error(parser, "The content cannot be read.");
+	}
+	if(!parser.has_error && !buffer.empty())
+	{
+		parse_stream_line(parser, buffer);
+	}
+	while(parser.open_node_count > 0 && !parser.has_error)
+	{
+		close_node(parser);
+	}
+	if(parser.has_error)
+	{
+		return create_ParserResult_error(parser.error_message);
+	}
+	timer.reset();
+	if(ARE_STATS_ENABLED && stats != nullptr)
+	{
+		stats->byte_count = byte_count;
+		stats->line_count = static_cast<uint64_t>(parser.line_number);
+		stats->node_count = parser.node_count - 1;
+		stats->unit_count = parser.real_unit_count;
+		stats->peak_depth = parser.peak_depth;
+	}
+
+	handle_unit_definitions(parser.unit_definitions);
+	if(!read_records(parser, handle_node))
+	{
+		return create_ParserResult_error(get_error_message_temporary_files());
+	}
+
+	ParserResult result;
+	result.has_error = false;
+	result.unit_definitions = std::move(parser.unit_definitions);
+	return result;
 }
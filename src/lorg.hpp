@@ -1,14 +1,22 @@
 #ifndef LORG_HPP
 #define LORG_HPP
 
-#include <map>
-#include <memory>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "arena.hpp"
+#include "stats.hpp"
+#include "unit_value.hpp"
+
 namespace lorg
 {
 
+class ThreadPool;
+
 constexpr char NODE_DEFINITION_CHARACTER = '#';
 constexpr char UNIT_DEFINITION_CHARACTER = '$';
 constexpr char UNIT_NAME_VALUE_SEPARATOR = ':';
@@ -17,33 +25,270 @@ std::vector<char> const IGNORED_CHARACTERS = {
 	'\r',
 };
 
-struct Unit
+// A unit definition is shared by all the units with the same name. Units only
+// refer to their definition through its index in
+// `ParserResult::unit_definitions`, called the unit ID.
+struct UnitDefinition
 {
-	// NOTE(nales, 2023-01-06): Would not it be better to reference the unit to
-	// a "unit definition" which holds the unit name? Something like:
-	//   int unit_type_reference;
-	// The unit definitions would be a mapping or an array. After all the units
-	// with the same "name" refers implicitely to a unit definition so we could
-	// make in the code this association more explicit.
 	std::string name;
+};
 
-	float value;
+// The value is stored by the backend chosen when lorg is built, see
+// `UnitValues`.
+struct Unit
+{
+	UnitValue value;
 	bool is_real;
 	bool is_ignored;
 };
 
+// A read-only view on the arrays of a tree, see `Tree`. The arrays are the
+// ones of a `Tree`, or the ones of a compiled tree mapped in memory.
+struct TreeView
+{
+	size_t node_count = 0;
+	size_t const * parents = nullptr;
+	size_t const * subtree_ends = nullptr;
+	size_t const * depths = nullptr;
+	std::string_view titles;
+	size_t const * title_offsets = nullptr;
+
+	size_t unit_count = 0;
+	UnitValue const * values = nullptr;
+	uint64_t const * real_masks = nullptr;
+	uint64_t const * ignored_masks = nullptr;
+
+	size_t get_mask_word_count() const noexcept
+	{
+		return (unit_count + 63) / 64;
+	}
+
+	bool has_children(size_t i) const noexcept
+	{
+		return subtree_ends[i] > i + 1;
+	}
+
+	std::string_view get_title(size_t i) const noexcept
+	{
+		size_t const end = (
+			i + 1 < node_count ? title_offsets[i + 1] : titles.size()
+		);
+		return titles.substr(title_offsets[i], end - title_offsets[i]);
+	}
+
+	Unit get_unit(size_t i, size_t id) const noexcept
+	{
+		size_t const word = i * get_mask_word_count() + id / 64;
+		uint64_t const bit = uint64_t(1) << (id % 64);
+		return Unit{
+			values[i * unit_count + id],
+			(real_masks[word] & bit) != 0,
+			(ignored_masks[word] & bit) != 0
+		};
+	}
+};
+
+// All the nodes of a tree, stored in pre-order so the subtree of a node is
+// the range of nodes from this node to its subtree end. The node 0 is the
+// total node, whose children are the nodes of level 1.
+//
+// The units are stored in a row-major matrix of node × unit ID, so the units
+// of a node are contiguous. Whether a unit is real or ignored is stored in bit
+// masks of `get_mask_word_count()` words per node.
+struct Tree
+{
+	// The total node is its own parent.
+	std::vector<size_t> parents;
+	std::vector<size_t> subtree_ends;
+	// The level of the nodes, 0 for the total node.
+	std::vector<size_t> depths;
+
+	// The title of the node `i` starts at `title_offsets[i]` in `titles` and
+	// ends at the start of the next one.
+	std::string titles;
+	std::vector<size_t> title_offsets;
+
+	size_t unit_count = 0;
+	std::vector<UnitValue> values;
+	std::vector<uint64_t> real_masks;
+	std::vector<uint64_t> ignored_masks;
+
+	size_t get_node_count() const noexcept
+	{
+		return parents.size();
+	}
+
+	size_t get_mask_word_count() const noexcept
+	{
+		return (unit_count + 63) / 64;
+	}
+
+	TreeView get_view() const noexcept
+	{
+		TreeView view;
+		view.node_count = get_node_count();
+		view.parents = parents.data();
+		view.subtree_ends = subtree_ends.data();
+		view.depths = depths.data();
+		view.titles = titles;
+		view.title_offsets = title_offsets.data();
+		view.unit_count = unit_count;
+		view.values = values.data();
+		view.real_masks = real_masks.data();
+		view.ignored_masks = ignored_masks.data();
+		return view;
+	}
+};
+
+// A read-only view on the arrays of an index, see `TreeIndex`. It is empty
+// when the tree has no index.
+struct TreeIndexView
+{
+	size_t node_count = 0;
+	size_t path_slot_count = 0;
+	uint64_t const * path_hashes = nullptr;
+	size_t const * path_nodes = nullptr;
+	size_t const * title_nodes = nullptr;
+
+	bool is_empty() const noexcept
+	{
+		return node_count == 0;
+	}
+};
+
+// The node of the empty slots of the path table of an index.
+constexpr size_t NO_NODE = SIZE_MAX;
+
+// At most two thirds of the slots of the path table are used, so the slots
+// probed to find a path are few.
+inline size_t get_path_slot_count(size_t node_count) noexcept
+{
+	size_t slot_count = 1;
+	while(slot_count < node_count + node_count / 2)
+	{
+		slot_count *= 2;
+	}
+	return slot_count;
+}
+
+// An index to find the nodes of a tree by path or by title without walking
+// the tree. Like the tree, it is made of arrays so it can be compiled with it.
+struct TreeIndex
+{
+	size_t node_count = 0;
+
+	// A hash table of the paths of all the nodes. A path is in the first slot
+	// from its hash modulo the slot count that was empty when it was added,
+	// so the nodes with the same path are found in pre-order. The slots hold
+	// the hash of a path and its node, or `NO_NODE`.
+	std::vector<uint64_t> path_hashes;
+	std::vector<size_t> path_nodes;
+
+	// All the nodes but the total node, in the order of their titles then in
+	// pre-order.
+	std::vector<size_t> title_nodes;
+
+	TreeIndexView get_view() const noexcept
+	{
+		TreeIndexView view;
+		view.node_count = node_count;
+		view.path_slot_count = path_nodes.size();
+		view.path_hashes = path_hashes.data();
+		view.path_nodes = path_nodes.data();
+		view.title_nodes = title_nodes.data();
+		return view;
+	}
+};
+
+// Copy the arrays of the view, like the ones of a compiled index.
+TreeIndex copy_tree_index(TreeIndexView const & view);
+
+// Returns the nodes whose path is made of `titles`, from the title of level 1
+// to the title of the node, in pre-order. The node 0 is the one of the empty
+// path.
+std::vector<size_t> find_nodes_by_path(
+	TreeView const & tree, TreeIndexView const & index,
+	std::vector<std::string_view> const & titles
+);
+
+// Returns the nodes whose title starts with `prefix`, in the order of their
+// titles.
+std::vector<size_t> find_nodes_by_title_prefix(
+	TreeView const & tree, TreeIndexView const & index, std::string_view prefix
+);
+
+// A pattern matching the titles of nodes, made of the parts that must appear
+// in order in the title, separated by wildcards matching any characters. The
+// first part starts the title and the last part ends it.
+struct TitlePattern
+{
+	std::vector<std::string> parts;
+};
+
+// A pattern matching the paths of nodes, which are the titles from their
+// ancestor of level 1 to themselves. The empty path is the one of the total
+// node.
+struct PathPattern
+{
+	std::vector<TitlePattern> titles;
+};
+
+constexpr char NODE_PATH_SEPARATOR = '/';
+constexpr char PATH_PATTERN_WILDCARD = '*';
+constexpr char PATH_PATTERN_ESCAPE = '\\';
+
+// Read a path pattern like `House/Second floor/*`. The titles are separated by
+// `NODE_PATH_SEPARATOR` and `PATH_PATTERN_WILDCARD` matches any characters.
+// `PATH_PATTERN_ESCAPE` makes the next character match itself, for the titles
+// containing the separator or the wildcard.
+PathPattern read_path_pattern(std::string_view pattern);
+
+// Returns false if a title of the pattern is empty, like in `House//Room`. No
+// node has an empty title, so the pattern could never match.
+bool is_path_pattern_correct(PathPattern const & pattern) noexcept;
+
+bool does_title_match(TitlePattern const & pattern, std::string_view title);
+
+// Returns the nodes matching one of the patterns, in pre-order. The nodes in
+// the subtree of another selected node are not returned, the subtree already
+// holds them. Only the nodes whose path can still match are visited, and the
+// patterns without wildcards are looked up in the index when there is one.
+std::vector<size_t> select_nodes(
+	TreeView const & tree, std::vector<PathPattern> const & patterns,
+	TreeIndexView const & index = TreeIndexView()
+);
+
+// Whether the nodes of the subtree of `root` link to each other like the nodes
+// of a tree in pre-order, so the subtree can be walked and printed without
+// leaving the arrays nor looping. The trees built by lorg always are, the
+// compiled trees read without their content check may not be.
+bool is_subtree_correct(TreeView const & tree, size_t root) noexcept;
+
+// Like `select_nodes()`, on a tree whose links are not known to be correct.
+// Only the links walked to find the nodes and the subtrees of the nodes found
+// are checked, so a lookup in the index stays fast. Returns false if one of
+// them is incorrect.
+bool select_nodes_checked(
+	TreeView const & tree, std::vector<PathPattern> const & patterns,
+	TreeIndexView const & index, std::vector<size_t> & nodes
+);
+
+// Copy the arrays of the view, like the ones of a compiled tree, to modify
+// them.
+Tree copy_tree(TreeView const & view);
+
+// A node of a tree of pointers, for the code that is easier to write with
+// one. The nodes, their titles, their children and their units are all in the
+// arena of the `ParserResult` they are created from.
 struct Node
 {
-	std::vector<std::unique_ptr<Node>> children;
+	ArenaVector<Node *> children;
 
-	std::string title;
+	std::string_view title;
 
-	// NOTE(nales, 2023-01-06): Mapping unit name with a unit is maybe not the
-	// best thing. If we use something holding unit definitions and that each
-	// unit refers to their unit definition, then the key could be the unit
-	// definition reference. The definition here would be like:
-	//   std::map<int, Unit> units;
-	std::map<std::string, Unit> units;
+	// The units of the node indexed by their unit ID. After parsing, all nodes
+	// have one unit per unit definition.
+	ArenaVector<Unit> units;
 };
 
 struct ParserResult
@@ -51,11 +296,162 @@ struct ParserResult
 	bool has_error;
 	std::string error_message;
 
+	// The definitions of all the units found while parsing, in the order of
+	// their first appearance.
+	std::vector<UnitDefinition> unit_definitions;
+
 	// Hold the calculation for all the parsed nodes.
-	std::unique_ptr<Node> total_node;
+	Tree tree;
+
+	// Empty unless `ParserOptions::build_index` is true.
+	TreeIndex index;
+
+	// Hold the nodes created by `create_node_tree()`. They are released at
+	// once with the result, so even the deepest trees are released without
+	// recursion.
+	Arena arena;
 };
 
-ParserResult parse(std::string const & content);
+struct ParserOptions
+{
+	// The number of threads used for parsing and calculating the units.
+	size_t jobs = 1;
+
+	// Build the index of the tree with it, see `TreeIndex`.
+	bool build_index = false;
+
+	// When it is not null, the time of each step is added to it, and its
+	// counters are set from the content and the tree.
+	Stats * stats = nullptr;
+};
+
+// The content is only read during the call, the result does not refer to it.
+ParserResult parse(
+	std::string_view content, ParserOptions const & options = ParserOptions()
+);
+// Like `parse()`, on the threads of `pool` instead of `options.jobs` threads,
+// or on the calling thread if `pool` is null. A task of `pool` cannot call it
+// with `pool`, it would wait for itself.
+ParserResult parse(
+	std::string_view content, ThreadPool * pool, ParserOptions const & options = ParserOptions()
+);
+
+// Returns true if a content of `size` bytes is big enough for `parse()` to
+// split it into chunks parsed on several threads.
+bool is_parsed_in_chunks(size_t size) noexcept;
+
+// The steps done by `parse()`. They are exposed to be able to run and measure
+// them separately.
+//
+// Build the tree from the content. The units not defined in the content are
+// not calculated.
+ParserResult convert_string_to_nodes(
+	std::string_view content, ParserOptions const & options = ParserOptions()
+);
+// Add the missing units to all the nodes and calculate them.
+void update_node_unit_values(
+	ParserResult & result, ParserOptions const & options = ParserOptions()
+);
+// Build the index of the tree, done by the other steps with
+// `options.build_index`.
+TreeIndex build_tree_index(
+	TreeView const & tree, ParserOptions const & options = ParserOptions()
+);
+
+// A fast hash mixing the bytes by words. It only detects changes, it does not
+// resist to crafted collisions.
+uint64_t hash_bytes(std::string_view bytes) noexcept;
+
+// The hash of the content of each node, from the start of its definition line
+// to the start of the next node definition, indexed like the nodes of the
+// tree. The content of the total node is the one before the first node.
+std::vector<uint64_t> hash_node_contents(std::string_view content);
+
+// Parse a new version of the content of a calculated result, given with the
+// hashes of its previous content. The tree of the previous result is updated
+// in place: only the nodes whose content changed are parsed, and only them and
+// their ancestors are calculated again. The tree is the one `parse()` gives,
+// except that the units keep their previous IDs. With `options.build_index`,
+// the index of the previous result is kept unless a title changed.
+//
+// The whole content is parsed when there are no previous hashes, when nodes
+// are added, removed or moved to another level, when the content before the
+// first node changes, or when a unit appears or disappears from the content.
+// `node_hashes` is set to the hashes of the new content in all cases.
+ParserResult parse_incrementally(
+	std::string_view content, ParserResult previous,
+	uint64_t const * previous_node_hashes, std::vector<uint64_t> & node_hashes,
+	ParserOptions const & options = ParserOptions()
+);
+
+// A calculated tree to merge with `merge_trees()`, with the definitions of its
+// units.
+struct MergedTree
+{
+	std::string_view title;
+	TreeView tree;
+	std::vector<UnitDefinition> const * unit_definitions = nullptr;
+};
+
+// Merge calculated trees into one, under a new total node calculated from
+// them. The total node of each tree becomes a node of level 1 titled `title`,
+// and the units with the same name in several trees get the same ID. The
+// trees are copied and the result has no index.
+ParserResult merge_trees(
+	std::vector<MergedTree> const & trees, ParserOptions const & options = ParserOptions()
+);
+// Like `merge_trees()`, on the threads of `pool`, see `parse()`.
+ParserResult merge_trees(
+	std::vector<MergedTree> const & trees, ThreadPool * pool,
+	ParserOptions const & options = ParserOptions()
+);
+
+// A node given by `parse_stream()`.
+struct StreamedNode
+{
+	// The index of the node in pre-order. The total node is the node 0.
+	size_t index;
+	size_t depth;
+
+	// The index following the last descendant of the node.
+	size_t subtree_end;
+
+	// Whether another child of its parent follows the node. For a selected
+	// node not in the subtree of another, whether another one follows.
+	bool has_next_sibling;
+
+	std::string_view title;
+
+	// One unit per unit definition, indexed by unit ID.
+	std::vector<Unit> const & units;
+};
+
+// Parse and calculate the content read from `input` with a memory bounded by
+// the depth of the tree times the number of units, instead of the size of the
+// content. The calculated nodes are written to temporary files. Then
+// `handle_unit_definitions` is called, followed by `handle_node` for each node
+// in pre-order, the total node included. They are not called if the content
+// is incorrect.
+//
+// When `selection` is not empty, `handle_node` is only called for the nodes
+// matching one of its patterns and their descendants, see `select_nodes()`.
+// The other nodes are neither written nor calculated.
+//
+// The returned result has no tree. When `stats` is not null, the time spent
+// parsing is added to it and its counters are set, the time spent in the
+// handlers is not.
+ParserResult parse_stream(
+	std::FILE * input,
+	std::function<void(std::vector<UnitDefinition> const &)> const & handle_unit_definitions,
+	std::function<void(StreamedNode const &)> const & handle_node,
+	std::vector<PathPattern> const & selection = std::vector<PathPattern>(),
+	Stats * stats = nullptr
+);
+
+// Create a `Node` for each node of the tree. They are copies, so the tree must
+// be calculated before. Returns the total node, which lives as long as the
+// result.
+Node * create_node_tree(ParserResult & result);
 }
 
 #endif
@@ -1,11 +1,18 @@
 #include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <iostream>
-#include <sstream>
-#include <stack>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
 
 #if defined(__unix__) || (defined (__APPLE__) && defined (__MACH__))
 #define IS_POSIX 1
@@ -14,21 +21,53 @@
 #endif
 
 #if IS_POSIX
+// Needed to map the files in memory.
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 // Needed to test if the software was called after a pipe.
 #include <unistd.h>
+// Needed to watch the file and serve its tree.
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #endif
 
+#if defined(__linux__)
+#include <sys/inotify.h>
+#endif
+
+#include "compiled.hpp"
 #include "lorg.hpp"
+#include "output.hpp"
+#include "stats.hpp"
+#include "thread_pool.hpp"
 
 #define VERSION "1.0"
 
-// Indentation step for printing prettily JSON.
-#define INDENTATION_STEP "    "
-
 constexpr int EXIT_CODE_OK = 0;
 constexpr int EXIT_CODE_ERROR_ARGUMENTS = 1;
 constexpr int EXIT_CODE_ERROR_PARSE = 2;
 
+// Size of the blocks read at once when the content cannot be mapped in memory.
+constexpr size_t READ_BLOCK_SIZE = 1 << 20;
+
+// Without inotify, the watched file is checked at this interval.
+constexpr int WATCH_INTERVAL_MILLISECONDS = 500;
+
+// The longest request line accepted by the server.
+constexpr size_t MAX_REQUEST_SIZE = 1 << 12;
+
+// A client is disconnected when it sends or receives nothing for this long.
+constexpr std::chrono::seconds CLIENT_TIMEOUT(5);
+
+// The most clients served at once. The next ones wait to be accepted.
+constexpr size_t MAX_CLIENT_COUNT = 64;
+
+// The files of a batch are calculated by windows of this many files per
+// thread, then printed, so only the trees of a window are in memory.
+constexpr size_t BATCH_FILES_PER_THREAD = 4;
+
 struct Config
 {
 	bool print_help = false;
@@ -36,112 +75,215 @@ struct Config
 	bool display_total_node = false;
 	bool prettify = false;
 	bool to_json = false;
+	// The number of threads, 0 for one thread per core.
+	size_t jobs = 1;
+	// Exit without releasing the parsed nodes.
+	bool skip_teardown = false;
+	// Print the result without holding the whole tree in memory.
+	bool stream = false;
+	lorg::NumberFormat number_format;
+	// Write the compiled tree instead of printing it.
+	bool compile = false;
+	// Parse only the nodes changed since the file was compiled, then compile
+	// it again.
+	bool incremental = false;
+	// Print the result again each time the file changes.
+	bool watch = false;
+	// Answer the requests of this Unix socket, if it is not empty.
+	std::string socket_path;
+	// Only print the subtrees of the nodes matching one of these patterns, or
+	// the whole tree if there are none.
+	std::vector<lorg::PathPattern> selection;
+	// Only print the units with these names, or all of them if there are
+	// none.
+	std::vector<std::string> unit_names;
+	// Print the statistics of the run to the standard error, in JSON with
+	// `stats_to_json`.
+	bool print_stats = false;
+	bool stats_to_json = false;
+	// Merge the trees of the files under one total node instead of printing
+	// them one by one.
+	bool merge = false;
 };
 
 struct CommandArguments
 {
-	std::string filepath;
+	// Empty to read the standard input.
+	std::vector<std::string> filepaths;
+	// Read more file paths from this file, or from the standard input if it
+	// is `-`.
+	std::string file_list_path;
+	// Whether several files are calculated, see `run_batch()`.
+	bool is_batch = false;
 	Config config;
 };
 
-// Container used to print the nodes. The goal is to avoid using recursion. The
-// structure contains information that would have been send as function
-// parameters if it was done in a recursive way.
-struct PrintContainer
+// Hold the content to parse. Regular files are mapped in memory so their
+// content is never copied. The other inputs, like pipes, are read into
+// `buffer`.
+struct Content
 {
-	lorg::Node const & node;
-	int const level;
+	std::string_view view;
+	std::string buffer;
 
-	// `has_next_sibling` and `prefix_from_parent` are useful for pretty print.
-	bool const has_next_sibling;
-	std::string const prefix_from_parent;
+#if IS_POSIX
+	void * mapping = MAP_FAILED;
+	size_t mapping_size = 0;
+#endif
 
-	PrintContainer(
-		lorg::Node const & node, int const level,
-		bool has_next_sibling=false, std::string prefix_from_parent=""
-	):
-		node(node), level(level),
-		has_next_sibling(has_next_sibling), prefix_from_parent(prefix_from_parent)
-	{
-	}
-};
+	Content() = default;
+	Content(Content const &) = delete;
+	Content & operator=(Content const &) = delete;
 
-// Returns the content from stdin if the software was called in after a pipe.
-//   Example: `cat file.lorg | lorg` or `lorg <(cat file.lorg)`
-// Returns an empty string if the software was not called after a pipe.
-std::string get_stdin_content_from_pipe()
-{
-#if IS_POSIX
-	bool is_from_pipe = !isatty(fileno(stdin));
-	if(is_from_pipe)
+	~Content()
 	{
-		std::string content;
-		for(std::string line; std::getline(std::cin, line);)
+#if IS_POSIX
+		if(mapping != MAP_FAILED)
 		{
-			content += line + "\n";
+			munmap(mapping, mapping_size);
 		}
-		return content;
-	}
-	else
-	{
-		return "";
-	}
-#else
-	return "";
 #endif
-}
+	}
+};
 
-// Useful for comparing `argv[i]` with a litteral string.
-bool are_equal(char const * const str1, std::string && str2)
+#if IS_POSIX
+// Read the content of the file descriptor. Returns false if it cannot be read.
+bool read_file_descriptor(int fd, Content & content)
 {
-	return str2.compare(str1) == 0;
-}
+	struct stat file_status;
+	if(fstat(fd, &file_status) != 0)
+	{
+		return false;
+	}
 
-std::string escape_json(std::string const & str)
-{
-	std::string escaped;
-	for(char const & c : str)
+	// Map the regular files. Empty files cannot be mapped but there is
+	// nothing to read anyway.
+	if(S_ISREG(file_status.st_mode))
 	{
-		if(c == '"')
-		{
-			escaped.append("\\\"");
-		}
-		else if(c == '\\')
+		size_t const size = static_cast<size_t>(file_status.st_size);
+		if(size == 0)
 		{
-			escaped.append("\\\\");
+			content.view = std::string_view();
+			return true;
 		}
-		else if(c == '\n')
+		void * mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(mapping != MAP_FAILED)
 		{
-			escaped.append("\\n");
+			madvise(mapping, size, MADV_SEQUENTIAL);
+			content.mapping = mapping;
+			content.mapping_size = size;
+			content.view = std::string_view(static_cast<char const *>(mapping), size);
+			return true;
 		}
-		else if(c == '\r')
+		// If the mapping failed, we still try to read the file normally.
+	}
+
+	// Read by large blocks directly into the buffer, which grows
+	// geometrically.
+	std::string & buffer = content.buffer;
+	size_t size = 0;
+	while(true)
+	{
+		if(buffer.size() - size < READ_BLOCK_SIZE)
 		{
-			escaped.append("\\r");
+			buffer.resize(std::max(2 * buffer.size(), size + READ_BLOCK_SIZE));
 		}
-		else if(c == '\t')
+		ssize_t const read_size = read(fd, &buffer[size], buffer.size() - size);
+		if(read_size == 0)
 		{
-			escaped.append("\\t");
+			break;
 		}
-		else if('\x00' <= c && c <= '\x1f')
+		else if(read_size < 0)
 		{
-			escaped.append("\\u00");
-			if('\x00' <= c && c < '\x10')
+			if(errno == EINTR)
 			{
-				escaped.push_back('0');
-			}
-			std::ostringstream os;
-			os << std::hex << static_cast<int>(c);
-			for(char const & oc : os.str())
-			{
-				escaped.push_back(oc);
+				continue;
 			}
+			return false;
 		}
-		else
+		size += static_cast<size_t>(read_size);
+	}
+	buffer.resize(size);
+	content.view = buffer;
+	return true;
+}
+#else
+// Read the content of the file. Returns false if it cannot be read.
+bool read_file(FILE * f, Content & content)
+{
+	std::string & buffer = content.buffer;
+	size_t size = 0;
+	while(true)
+	{
+		buffer.resize(size + READ_BLOCK_SIZE);
+		size_t const read_size = std::fread(&buffer[size], 1, READ_BLOCK_SIZE, f);
+		size += read_size;
+		if(read_size < READ_BLOCK_SIZE)
+		{
+			break;
+		}
+	}
+	buffer.resize(size);
+	content.view = buffer;
+	return std::ferror(f) == 0;
+}
+#endif
+
+bool is_stdin_from_pipe()
+{
+#if IS_POSIX
+	return !isatty(STDIN_FILENO);
+#else
+	return false;
+#endif
+}
+
+// Get the content from stdin if the software was called in after a pipe.
+//   Example: `cat file.lorg | lorg` or `lorg <(cat file.lorg)`
+// The content is empty if the software was not called after a pipe.
+void get_stdin_content_from_pipe(Content & content)
+{
+#if IS_POSIX
+	if(is_stdin_from_pipe())
+	{
+		if(!read_file_descriptor(STDIN_FILENO, content))
 		{
-			escaped.push_back(c);
+			content.view = std::string_view();
 		}
 	}
-	return escaped;
+#else
+	(void)content;
+#endif
+}
+
+inline bool is_digit(char const & c)
+{
+	return '0' <= c && c <= '9';
+}
+
+// Useful for comparing `argv[i]` with a litteral string.
+bool are_equal(char const * const str1, std::string && str2)
+{
+	return str2.compare(str1) == 0;
+}
+
+// Read the number given to the option at `argv[i]`.
+size_t read_number_argument_or_exit(
+	int argc, char const * const argv[], int i, char const * const option
+)
+{
+	size_t number = 0;
+	char * end = nullptr;
+	if(i < argc && is_digit(argv[i][0]))
+	{
+		number = std::strtoul(argv[i], &end, 10);
+	}
+	if(end == nullptr || *end != '\0')
+	{
+		std::cerr << "The option \"" << option << "\" needs a number." << std::endl;
+		exit(EXIT_CODE_ERROR_ARGUMENTS);
+	}
+	return number;
 }
 
 CommandArguments parse_command_arguments_or_exit(int argc, char const * const argv[])
@@ -206,33 +348,169 @@ CommandArguments parse_command_arguments_or_exit(int argc, char const * const ar
 		{
 			config.to_json = true;
 		}
-		else
+		else if(are_equal(argv[i], "--no-teardown"))
+		{
+			config.skip_teardown = true;
+		}
+		else if(are_equal(argv[i], "--stream"))
+		{
+			config.stream = true;
+		}
+		else if(are_equal(argv[i], "--compile"))
+		{
+			config.compile = true;
+		}
+		else if(are_equal(argv[i], "--incremental"))
+		{
+			config.incremental = true;
+		}
+		else if(are_equal(argv[i], "--watch"))
+		{
+			config.watch = true;
+		}
+		else if(are_equal(argv[i], "--serve"))
+		{
+			i++;
+			if(i >= argc)
+			{
+				std::cerr << "The option \"--serve\" needs a socket path." << std::endl;
+				exit(EXIT_CODE_ERROR_ARGUMENTS);
+			}
+			config.socket_path = argv[i];
+		}
+		else if(are_equal(argv[i], "--select") || are_equal(argv[i], "--unit"))
 		{
-			if(arguments.filepath.empty())
+			char const * const option = argv[i];
+			i++;
+			if(i >= argc)
 			{
-				arguments.filepath = argv[i];
+				std::cerr << "The option \"" << option << "\" needs a value." << std::endl;
+				exit(EXIT_CODE_ERROR_ARGUMENTS);
 			}
-			else
+			if(are_equal(option, "--select"))
 			{
-				if(argv[i][0] == '-')
-				{
-					std::cerr << "Unknown option \"" << argv[i] << "\"." << std::endl;
-					exit(EXIT_CODE_ERROR_ARGUMENTS);
-				}
-				else
+				config.selection.push_back(lorg::read_path_pattern(argv[i]));
+				if(!lorg::is_path_pattern_correct(config.selection.back()))
 				{
-					std::cerr << "Only one file at a time can be parsed." << std::endl;
+					std::cerr << "The path \"" << argv[i] << "\" has an empty title." << std::endl;
 					exit(EXIT_CODE_ERROR_ARGUMENTS);
 				}
 			}
+			else
+			{
+				config.unit_names.push_back(argv[i]);
+			}
+		}
+		else if(are_equal(argv[i], "--merge"))
+		{
+			config.merge = true;
+		}
+		else if(are_equal(argv[i], "--files-from"))
+		{
+			i++;
+			if(i >= argc)
+			{
+				std::cerr << "The option \"--files-from\" needs a file." << std::endl;
+				exit(EXIT_CODE_ERROR_ARGUMENTS);
+			}
+			arguments.file_list_path = argv[i];
+		}
+		else if(are_equal(argv[i], "--stats") || are_equal(argv[i], "--stats-json"))
+		{
+			config.print_stats = true;
+			config.stats_to_json = are_equal(argv[i], "--stats-json");
+		}
+		else if(are_equal(argv[i], "--jobs"))
+		{
+			i++;
+			config.jobs = read_number_argument_or_exit(argc, argv, i, "--jobs");
+		}
+		else if(are_equal(argv[i], "--precision") || are_equal(argv[i], "--fixed"))
+		{
+			char const * const option = argv[i];
+			i++;
+			size_t const precision = read_number_argument_or_exit(argc, argv, i, option);
+			if(precision > lorg::MAX_NUMBER_PRECISION)
+			{
+				std::cerr << "The option \"" << option << "\" needs a number up to ";
+				std::cerr << lorg::MAX_NUMBER_PRECISION << "." << std::endl;
+				exit(EXIT_CODE_ERROR_ARGUMENTS);
+			}
+			config.number_format.precision = static_cast<int>(precision);
+			config.number_format.is_fixed = are_equal(option, "--fixed");
+		}
+		else
+		{
+			if(!arguments.filepaths.empty() && argv[i][0] == '-')
+			{
+				std::cerr << "Unknown option \"" << argv[i] << "\"." << std::endl;
+				exit(EXIT_CODE_ERROR_ARGUMENTS);
+			}
+			arguments.filepaths.push_back(argv[i]);
 		}
 		i++;
 	}
 
+	arguments.is_batch = (
+		arguments.filepaths.size() > 1 || !arguments.file_list_path.empty() || config.merge
+	);
+	bool const is_daemon = config.watch || !config.socket_path.empty();
+	if(arguments.is_batch && (config.stream || config.compile || config.incremental || is_daemon || config.print_stats))
+	{
+		std::cerr << "The options \"--stream\", \"--compile\", \"--incremental\", ";
+		std::cerr << "\"--watch\", \"--serve\" and \"--stats\" need a single file." << std::endl;
+		exit(EXIT_CODE_ERROR_ARGUMENTS);
+	}
+	if(arguments.is_batch && !config.merge && config.to_json && config.prettify)
+	{
+		std::cerr << "Several files are printed as JSON lines, which cannot be prettified." << std::endl;
+		exit(EXIT_CODE_ERROR_ARGUMENTS);
+	}
+	bool const has_file = !arguments.filepaths.empty();
+
+	if(config.compile && !has_file)
+	{
+		std::cerr << "The option \"--compile\" needs a file." << std::endl;
+		exit(EXIT_CODE_ERROR_ARGUMENTS);
+	}
+	if(config.compile && config.stream)
+	{
+		std::cerr << "The options \"--compile\" and \"--stream\" cannot be used together." << std::endl;
+		exit(EXIT_CODE_ERROR_ARGUMENTS);
+	}
+	if(config.incremental && !has_file)
+	{
+		std::cerr << "The option \"--incremental\" needs a file." << std::endl;
+		exit(EXIT_CODE_ERROR_ARGUMENTS);
+	}
+	if(config.incremental && config.stream)
+	{
+		std::cerr << "The options \"--incremental\" and \"--stream\" cannot be used together." << std::endl;
+		exit(EXIT_CODE_ERROR_ARGUMENTS);
+	}
+	char const * const daemon_option = config.watch ? "--watch" : "--serve";
+	if(is_daemon && !has_file)
+	{
+		std::cerr << "The option \"" << daemon_option << "\" needs a file." << std::endl;
+		exit(EXIT_CODE_ERROR_ARGUMENTS);
+	}
+	if(is_daemon && (config.stream || config.compile || config.incremental || config.print_stats))
+	{
+		std::cerr << "The option \"" << daemon_option << "\" cannot be used with ";
+		std::cerr << "\"--stream\", \"--compile\", \"--incremental\" or \"--stats\"." << std::endl;
+		exit(EXIT_CODE_ERROR_ARGUMENTS);
+	}
+	if(config.print_stats && !lorg::ARE_STATS_ENABLED)
+	{
+		std::cerr << "The option \"--stats\" is not supported by this build." << std::endl;
+		exit(EXIT_CODE_ERROR_ARGUMENTS);
+	}
+
 	return arguments;
 }
 
-std::string get_file_content_or_exit(std::string const filepath)
+// Read the content of the file. Returns false if it cannot be read.
+bool read_file_content(std::string const & filepath, Content & content)
 {
 	// NOTE(nales, 2023-01-06): I do not use `filesystem` because this is not
 	// at all portable. For some moronic reasons some people thought it was a
@@ -244,354 +522,1195 @@ std::string get_file_content_or_exit(std::string const filepath)
 	// I have other stuff to do in my life rather than fixing some stupid
 	// issues like that. I use `cstdio` and the C standard library like any
 	// sane person would do.
+#if IS_POSIX
+	int fd = open(filepath.c_str(), O_RDONLY);
+	bool is_read = fd >= 0 && read_file_descriptor(fd, content);
+	if(fd >= 0)
+	{
+		// The mapping stays valid after closing the file.
+		close(fd);
+	}
+#else
 	FILE* f = std::fopen(filepath.c_str(), "r");
+	bool is_read = f != NULL && read_file(f, content);
+	if(f != NULL)
+	{
+		std::fclose(f);
+	}
+#endif
+	return is_read;
+}
 
+void get_file_content_or_exit(std::string const filepath, Content & content)
+{
 	// Check if file can be read.
-	if(f == NULL)
+	if(!read_file_content(filepath, content))
 	{
 		std::cerr << "\"" << filepath << "\" cannot be read." << std::endl;
 		exit(EXIT_CODE_ERROR_ARGUMENTS);
 	}
+}
 
-	// Get the file content.
-	std::string content;
+lorg::ParserOptions get_parser_options(Config const & config)
+{
+	lorg::ParserOptions options;
+	options.jobs = config.jobs;
+	if(options.jobs == 0)
 	{
-		int c = std::fgetc(f);
-		while(c != EOF)
-		{
-			content.push_back(static_cast<char>(c));
-			c = std::fgetc(f);
-		}
+		options.jobs = std::max(1u, std::thread::hardware_concurrency());
 	}
-	std::fclose(f);
-	return content;
+	return options;
 }
 
-// We do not want to override the `<<` operator just for that. It makes
-// semantically no sense.
-void cout_unit(std::ostream & o, lorg::Unit const & unit)
+lorg::PrinterOptions get_printer_options(Config const & config)
 {
-	o << "$ " << unit.name << ": " << unit.value;
-	if(!unit.is_real)
-	{
-		o << " [Calculated]";
-	}
-	if(unit.is_ignored)
-	{
-		o << " [Ignored]";
-	}
+	lorg::PrinterOptions options;
+	options.prettify = config.prettify;
+	options.to_json = config.to_json;
+	options.number_format = config.number_format;
+	options.unit_names = config.unit_names;
+	return options;
 }
 
-void print_simple(
-	std::vector<lorg::Node const *> const root_nodes,
-	std::vector<std::string> const & sorted_unit_names
+// Returns the error message for the first unit of `--unit` which is not
+// defined in the tree, or an empty string. Only the units of the tree can be
+// printed, so the other names are typing errors.
+std::string check_unit_names(
+	Config const & config, std::vector<lorg::UnitDefinition> const & unit_definitions
 )
 {
-	std::stack<PrintContainer> nodes_to_print;
-	for(auto it = root_nodes.crbegin(); it != root_nodes.crend(); it++)
-	{
-		nodes_to_print.push(PrintContainer(**it, 1));
-	}
-	while(!nodes_to_print.empty())
+	for(std::string const & name : config.unit_names)
 	{
-		PrintContainer current = nodes_to_print.top();
-		nodes_to_print.pop();
-		lorg::Node const & node = current.node;
-		int const & level = current.level;
-
-		std::string indentation;
-		for(int i = 0; i < level - 1; i++)
-		{
-			indentation += "  ";
-		}
-
-		// Print the title.
-		std::cout << indentation;
-		for(int i = 0; i < level; i++)
-		{
-			std::cout << '#';
-		}
-		std::cout << " " << node.title << std::endl;
-
-		// Print the units.
-		for(auto const & name : sorted_unit_names)
-		{
-			lorg::Unit const & unit = node.units.at(name);
-			std::cout << indentation << "  ";
-			cout_unit(std::cout, unit);
-			std::cout << std::endl;
-		}
-
-		// Add the children for printing.
-		for(auto it = node.children.crbegin(); it != node.children.crend(); it++)
+		bool const is_defined = std::any_of(
+			unit_definitions.begin(), unit_definitions.end(),
+			[&name](lorg::UnitDefinition const & unit_definition)
+			{
+				return unit_definition.name == name;
+			}
+		);
+		if(!is_defined)
 		{
-			auto const & child = *it;
-			nodes_to_print.push(PrintContainer(*child, level + 1));
+			return "The unit \"" + name + "\" is not defined.";
 		}
 	}
+	return std::string();
 }
 
-void print_pretty(
-	std::vector<lorg::Node const *> const root_nodes,
-	std::vector<std::string> const & sorted_unit_names
+void check_unit_names_or_exit(
+	Config const & config, std::vector<lorg::UnitDefinition> const & unit_definitions
 )
 {
-	std::stack<PrintContainer> nodes_to_print;
-	for(auto it = root_nodes.crbegin(); it != root_nodes.crend(); it++)
+	std::string const error_message = check_unit_names(config, unit_definitions);
+	if(!error_message.empty())
 	{
-		nodes_to_print.push(PrintContainer(**it, 1));
+		std::cerr << error_message << std::endl;
+		exit(EXIT_CODE_ERROR_ARGUMENTS);
 	}
-	while(!nodes_to_print.empty())
-	{
-		PrintContainer current = nodes_to_print.top();
-		nodes_to_print.pop();
-		lorg::Node const & node = current.node;
-		int const & level = current.level;
-		bool const & has_next_sibling = current.has_next_sibling;
-		std::string const & prefix_from_parent = current.prefix_from_parent;
-
-		// Print the title.
-		if(level == 1)
-		{
-			std::cout << node.title << std::endl;
-		}
-		else
-		{
-			if(has_next_sibling)
-			{
-				std::cout << prefix_from_parent << "├── " << node.title << std::endl;
-			}
-			else
-			{
-				std::cout << prefix_from_parent << "└── " << node.title << std::endl;
-			}
-		}
-
-		// Set up the prefix for the children.
-		std::string prefix_for_next_lines;
-		if(level > 1)
-		{
-			std::string to_add = has_next_sibling ? "│   " : "    ";
-			prefix_for_next_lines = prefix_from_parent + to_add;
-		}
-
-		// Print the units.
-		for(auto const & name : sorted_unit_names)
-		{
-			lorg::Unit const & unit = node.units.at(name);
-			if(node.children.empty())
-			{
-				std::cout << prefix_for_next_lines << "  ";
-			}
-			else
-			{
-				std::cout << prefix_for_next_lines << "│ ";
-			}
-			cout_unit(std::cout, unit);
-			std::cout << std::endl;
-		}
+}
 
-		// Add the children for printing.
-		if(!node.children.empty())
-		{
-			auto it = node.children.crbegin();
-			nodes_to_print.push(PrintContainer(**it, level + 1, false, prefix_for_next_lines));
-			it++;
-			for(; it != node.children.crend(); it++)
-			{
-				auto const & child = *it;
-				nodes_to_print.push(PrintContainer(*child, level + 1, true, prefix_for_next_lines));
-			}
-		}
+// Print the tree, or only the subtrees of the selected nodes when there is a
+// selection. Only the nodes that can match are visited to find them, or they
+// are found in the index of the tree when it has one.
+void print_selection(
+	lorg::Printer & printer, lorg::TreeView const & tree, lorg::TreeIndexView const & index,
+	std::vector<lorg::PathPattern> const & selection, bool display_total_node
+)
+{
+	if(selection.empty())
+	{
+		lorg::print_tree(printer, tree, display_total_node);
+		return;
 	}
+	lorg::print_subtrees(printer, tree, lorg::select_nodes(tree, selection, index));
 }
 
-inline std::string to_string(bool const v)
+// The characters separating the directories in a path.
+#if IS_POSIX
+constexpr char const * PATH_SEPARATORS = "/";
+#else
+constexpr char const * PATH_SEPARATORS = "/\\";
+#endif
+
+// Get the size and the modification time of the file. Returns false if they
+// cannot be known.
+bool get_compiled_source(std::string const & filepath, lorg::CompiledSource & source)
 {
-	return v ? "true" : "false";
+	size_t const name_start = filepath.find_last_of(PATH_SEPARATORS);
+	source.name = filepath.substr(name_start == std::string::npos ? 0 : name_start + 1);
+#if IS_POSIX
+	struct stat file_status;
+	if(stat(filepath.c_str(), &file_status) != 0)
+	{
+		return false;
+	}
+	source.size = static_cast<uint64_t>(file_status.st_size);
+#if defined(__APPLE__)
+	struct timespec const & modification_time = file_status.st_mtimespec;
+#else
+	struct timespec const & modification_time = file_status.st_mtim;
+#endif
+	source.modification_time = (
+		static_cast<int64_t>(modification_time.tv_sec) * 1000000000 +
+		static_cast<int64_t>(modification_time.tv_nsec)
+	);
+	return true;
+#else
+	return false;
+#endif
 }
 
-void print_json_unit(lorg::Unit const & unit)
+// `file.lorg` is compiled to `file.lorgb`, the other files get the extension.
+std::string get_compiled_filepath(std::string const & filepath)
 {
-	// NOTE(nales, 2023-01-06): Instead of escaping that everytime, maybe we
-	// should map the unit names with escaped unit names.
-	std::string escaped_unit_name = escape_json(unit.name);
-	std::cout << "\"" << escaped_unit_name << "\":{";
-	std::cout << "\"name\":\"" << escaped_unit_name << "\",";
-	std::cout << "\"value\":" << unit.value << ",";
-	std::cout << "\"isReal\":" << to_string(unit.is_real) << ",";
-	std::cout << "\"isIgnored\":" << to_string(unit.is_ignored);
-	std::cout << "}";
+	std::string_view const extension = ".lorg";
+	bool const has_extension = (
+		filepath.size() >= extension.size() &&
+		filepath.compare(filepath.size() - extension.size(), extension.size(), extension) == 0
+	);
+	return filepath + (has_extension ? "b" : ".lorgb");
 }
 
-void print_json_node(
-	lorg::Node const & node, std::vector<std::string> const & sorted_unit_names
+void write_compiled_tree_or_exit(
+	std::string const & filepath, lorg::CompiledSource const & source,
+	lorg::ParserResult const & result, std::vector<uint64_t> const & node_hashes
 )
 {
-	std::cout << "{";
-	// Print title.
-	std::cout << "\"title\":\"" << escape_json(node.title) << "\"";
+	lorg::CompiledTree compiled;
+	compiled.source = source;
+	compiled.unit_definitions = result.unit_definitions;
+	compiled.tree = result.tree.get_view();
+	compiled.node_hashes = node_hashes.data();
+	compiled.index = result.index.get_view();
 
-	// Print the units.
-	std::cout << ",\"units\":{";
+	// The compiled tree is written next to its path then renamed, so it is
+	// never read incomplete.
+	std::string const compiled_filepath = get_compiled_filepath(filepath);
+	std::string const temporary_filepath = compiled_filepath + ".tmp";
+	FILE * f = std::fopen(temporary_filepath.c_str(), "wb");
+	bool is_written = f != NULL && lorg::write_compiled_tree(f, compiled);
+	if(f != NULL)
 	{
-		// Needed to manage the last `,`.
-		std::string separator = "";
-		for(std::string const & name : sorted_unit_names)
-		{
-			std::cout << separator;
-			print_json_unit(node.units.at(name));
-			separator = ",";
-		}
+		is_written = std::fclose(f) == 0 && is_written;
 	}
-	std::cout << "}";
-
-	// Print children.
-	std::cout << ",\"children\":[";
-	if(node.children.size() > 0)
+	is_written = (
+		is_written &&
+		std::rename(temporary_filepath.c_str(), compiled_filepath.c_str()) == 0
+	);
+	if(!is_written)
 	{
-		for(size_t i = 0; i < node.children.size() - 1; i++)
-		{
-			print_json_node(*(node.children[i]), sorted_unit_names);
-			std::cout << ",";
-		}
-		print_json_node(*(node.children[node.children.size()-1]), sorted_unit_names);
+		std::remove(temporary_filepath.c_str());
+		std::cerr << "\"" << compiled_filepath << "\" cannot be written." << std::endl;
+		exit(EXIT_CODE_ERROR_ARGUMENTS);
 	}
-	std::cout << "]";
-
-	std::cout << "}";
 }
 
-void print_json(
-	std::vector<lorg::Node const *> const root_nodes,
-	std::vector<std::string> const & sorted_unit_names
-)
+// Returns an error message if the source of the compiled tree read from
+// `filepath` is found next to it and changed since it was compiled, or an
+// empty string.
+std::string check_compiled_source(std::string const & filepath, lorg::CompiledTree const & compiled)
 {
-	// NOTE(nales, 2023-01-06): This code should be refactored.
-	// We avoid recursion in this software because it is not compatible with large data.
-	// But for the moment, I do not know how to write this code using stacks (for example).
-	// Without recursion, I do not know how to print a part of a node before *and* after its children.
-
-	std::cout << "[";
-	if(root_nodes.size() > 0)
+	size_t const name_start = filepath.find_last_of(PATH_SEPARATORS);
+	std::string const source_filepath = (
+		filepath.substr(0, name_start == std::string::npos ? 0 : name_start + 1) +
+		compiled.source.name
+	);
+	lorg::CompiledSource source;
+	bool const is_outdated = (
+		get_compiled_source(source_filepath, source) &&
+		(
+			source.size != compiled.source.size ||
+			source.modification_time != compiled.source.modification_time
+		)
+	);
+	if(!is_outdated)
 	{
-		for(size_t i = 0; i < root_nodes.size() - 1; i++)
-		{
-			print_json_node(*(root_nodes[i]), sorted_unit_names);
-			std::cout << ",";
-		}
-		print_json_node(*(root_nodes[root_nodes.size()-1]), sorted_unit_names);
+		return std::string();
 	}
-	std::cout << "]";
-	std::cout << std::endl;
+	return (
+		"\"" + source_filepath + "\" changed since \"" + filepath +
+		"\" was compiled, compile it again."
+	);
 }
 
-void print_json_pretty_node(
-	lorg::Node const & node, std::vector<std::string> const & sorted_unit_names,
-	std::string const & indentation, bool has_sibling
+// Read the compiled tree of the content, read from `filepath` if it is not
+// empty, and print it. The source of the compiled tree is checked when it is
+// found next to it.
+void print_compiled_tree_or_exit(
+	std::string const & filepath, std::string_view content, Config const & config
 )
 {
-	std::string indentation_key = indentation + INDENTATION_STEP;
-	std::string indentation_value = indentation + INDENTATION_STEP + INDENTATION_STEP;
-
-	std::cout << indentation << "{" << std::endl;
-
-	// Print title.
-	std::cout << indentation_key << "\"title\": \"" << escape_json(node.title) << "\"," << std::endl;
-
-	// Print the units.
-	if(node.units.empty())
+	lorg::CompiledTree const compiled = lorg::read_compiled_tree(content);
+	if(compiled.has_error)
 	{
-		std::cout << indentation_key << "\"units\": {}," << std::endl;
+		std::cerr << compiled.error_message << std::endl;
+		exit(EXIT_CODE_ERROR_PARSE);
 	}
-	else
+
+	if(!filepath.empty())
 	{
-		std::cout << indentation_key << "\"units\": {" << std::endl;
-		// Needed to manage the last `},`.
-		bool is_first = true;
-		for(auto const & name : sorted_unit_names)
+		std::string const error_message = check_compiled_source(filepath, compiled);
+		if(!error_message.empty())
 		{
-			lorg::Unit const & unit = node.units.at(name);
-			// NOTE(nales, 2023-01-06): Instead of escaping that everytime,
-			// maybe we should map the unit names with escaped unit names.
-			std::string escaped_unit_name = escape_json(unit.name);
+			std::cerr << error_message << std::endl;
+			exit(EXIT_CODE_ERROR_PARSE);
+		}
+	}
 
-			std::string const & i = indentation_value;
-			std::string const & iv = i + INDENTATION_STEP;
+	check_unit_names_or_exit(config, compiled.unit_definitions);
 
-			if(is_first)
-			{
-				is_first = false;
-			}
+	// Only the links walked are checked, so a node selected in the index is
+	// printed without reading the whole tree.
+	std::vector<size_t> selected_nodes;
+	bool const is_correct = (
+		config.selection.empty() ?
+		lorg::is_compiled_tree_correct(compiled) :
+		lorg::select_nodes_checked(
+			compiled.tree, config.selection, compiled.index, selected_nodes
+		)
+	);
+	if(!is_correct)
+	{
+		std::cerr << lorg::get_error_message_compiled_tree_incorrect() << std::endl;
+		exit(EXIT_CODE_ERROR_PARSE);
+	}
+
+	lorg::Output output(stdout);
+	lorg::Printer printer(output, get_printer_options(config), compiled.unit_definitions);
+	if(config.selection.empty())
+	{
+		lorg::print_tree(printer, compiled.tree, config.display_total_node);
+		return;
+	}
+	lorg::print_subtrees(printer, compiled.tree, selected_nodes);
+}
+
+// Parse the content of the file at `filepath` from its compiled tree, when it
+// has one compiled from it, so only the nodes changed since are parsed again.
+// Otherwise the whole content is parsed.
+lorg::ParserResult parse_incrementally(
+	std::string const & filepath, std::string_view content,
+	lorg::ParserOptions const & options, std::vector<uint64_t> & node_hashes
+)
+{
+	// The compiled tree is only a cache, it is ignored if it cannot be used.
+	// The unchanged nodes are kept as they are in it, so its whole content is
+	// checked.
+	Content compiled_content;
+	lorg::CompiledTree compiled;
+	lorg::ParserResult previous;
+	{
+		lorg::ScopedTimer timer(options.stats, "read compiled");
+		compiled.has_error = !read_file_content(get_compiled_filepath(filepath), compiled_content);
+		if(!compiled.has_error)
+		{
+			compiled = lorg::read_compiled_tree(compiled_content.view, true);
+		}
+		lorg::CompiledSource source;
+		get_compiled_source(filepath, source);
+		previous.has_error = compiled.has_error || compiled.source.name != source.name;
+		if(!previous.has_error)
+		{
+			previous.unit_definitions = compiled.unit_definitions;
+			previous.tree = lorg::copy_tree(compiled.tree);
+			previous.index = lorg::copy_tree_index(compiled.index);
+		}
+	}
+	return lorg::parse_incrementally(
+		content, std::move(previous), compiled.node_hashes, node_hashes, options
+	);
+}
+
+// Parse the content of `input` with `lorg::parse_stream()` and print the
+// nodes to `output` as soon as they are read back. Returns the result of the
+// parsing.
+lorg::ParserResult parse_and_print_stream(
+	std::FILE * input, lorg::Output & output, Config const & config, lorg::Stats * stats
+)
+{
+	// The printer is created once the unit definitions are known, which is
+	// when the printing starts.
+	std::unique_ptr<lorg::Printer> printer;
+	std::optional<lorg::ScopedTimer> print_timer;
+
+	// With a selection, the selected nodes not in the subtree of another are
+	// printed at level 1. The current one ends at `root_end`.
+	bool const has_selection = !config.selection.empty();
+	size_t root_depth = 0;
+	size_t root_end = 0;
+
+	lorg::ParserResult result = lorg::parse_stream(
+		input,
+		[&output, &config, &printer, &print_timer, stats](std::vector<lorg::UnitDefinition> const & unit_definitions)
+		{
+			// Nothing is printed yet when a unit is not defined.
+			check_unit_names_or_exit(config, unit_definitions);
+			print_timer.emplace(stats, "print");
+			printer = std::make_unique<lorg::Printer>(
+				output, get_printer_options(config), unit_definitions
+			);
+			lorg::start_printing(*printer);
+		},
+		[&config, &printer, has_selection, &root_depth, &root_end](lorg::StreamedNode const & streamed_node)
+		{
+			size_t level;
+			if(has_selection)
+			{
+				if(streamed_node.index >= root_end)
+				{
+					root_depth = streamed_node.depth;
+					root_end = streamed_node.subtree_end;
+				}
+				level = streamed_node.depth + 1 - root_depth;
+			}
 			else
 			{
-				// Closing the last sibling unit JSON print.
-				std::cout << i << "}," << std::endl;
+				if(streamed_node.index < lorg::get_first_printed_node(config.display_total_node))
+				{
+					return;
+				}
+				level = lorg::get_printed_level(streamed_node.depth, config.display_total_node);
 			}
+			lorg::PrintedNode const node = {
+				level,
+				streamed_node.subtree_end > streamed_node.index + 1,
+				streamed_node.has_next_sibling,
+				streamed_node.title,
+				streamed_node.units
+			};
+			lorg::print_node(*printer, node);
+		},
+		config.selection,
+		stats
+	);
+	if(printer)
+	{
+		lorg::finish_printing(*printer);
+	}
+	print_timer.reset();
+	return result;
+}
 
-			std::cout << i << "\"" << escaped_unit_name << "\": {" << std::endl;
-			std::cout << iv << "\"name\": \"" << escaped_unit_name << "\"," << std::endl;
-			std::cout << iv << "\"value\": " << unit.value << "," << std::endl;
-			std::cout << iv << "\"isReal\": " << to_string(unit.is_real) << "," << std::endl;
-			std::cout << iv << "\"isIgnored\": " << to_string(unit.is_ignored) << std::endl;
+// Print the statistics of the run to the standard error, when they are asked.
+void print_stats(Config const & config, lorg::Stats & stats)
+{
+	if(!config.print_stats)
+	{
+		return;
+	}
+	lorg::finish_stats(stats);
+	std::cerr << lorg::format_stats(stats, config.stats_to_json) << std::flush;
+}
+
+// Add the paths listed in the file at `list_path`, or in the standard input
+// if it is `-`, one per line. The empty lines are skipped.
+void read_file_list_or_exit(std::string const & list_path, std::vector<std::string> & filepaths)
+{
+	Content content;
+	if(list_path == "-")
+	{
+		get_stdin_content_from_pipe(content);
+	}
+	else
+	{
+		get_file_content_or_exit(list_path, content);
+	}
+
+	std::string_view const list = content.view;
+	size_t line_start = 0;
+	while(line_start < list.size())
+	{
+		size_t line_end = list.find('\n', line_start);
+		line_end = line_end == std::string_view::npos ? list.size() : line_end;
+		std::string_view line = list.substr(line_start, line_end - line_start);
+		if(!line.empty() && line.back() == '\r')
+		{
+			line.remove_suffix(1);
 		}
-		if(!node.units.empty())
+		if(!line.empty())
 		{
-			// Closing the last sibling unit JSON print.
-			std::cout << indentation_value << "}" << std::endl;
+			filepaths.emplace_back(line);
 		}
-		std::cout << indentation_key << "}," << std::endl;
+		line_start = line_end + 1;
 	}
+}
 
-	// Print children.
-	if(node.children.empty())
+// Read the compiled tree of the content with all its links checked, since it
+// is copied whole.
+lorg::CompiledTree read_compiled_tree_to_copy(std::string_view content)
+{
+	lorg::CompiledTree compiled = lorg::read_compiled_tree(content);
+	if(!compiled.has_error && !lorg::is_compiled_tree_correct(compiled))
 	{
-		std::cout << indentation_key << "\"children\": []" << std::endl;
+		compiled.has_error = true;
+		compiled.error_message = lorg::get_error_message_compiled_tree_incorrect();
 	}
-	else
+	return compiled;
+}
+
+// A file of a batch and its calculated tree, or the error that prevented it.
+struct BatchFile
+{
+	std::string filepath;
+	lorg::ParserResult result;
+	// The exit code of the error, as if the file was given alone.
+	int exit_code = EXIT_CODE_OK;
+};
+
+void set_error(BatchFile & file, int exit_code, std::string const & error_message)
+{
+	file.result = lorg::ParserResult();
+	file.result.has_error = true;
+	file.result.error_message = error_message;
+	file.exit_code = exit_code;
+}
+
+// Read and calculate a file of a batch, on the threads of `pool`. The
+// compiled trees are copied, so all the contents are released once the file
+// is loaded.
+void load_batch_file(BatchFile & file, lorg::ThreadPool * pool)
+{
+	Content content;
+	if(!read_file_content(file.filepath, content))
+	{
+		set_error(file, EXIT_CODE_ERROR_ARGUMENTS, "The file cannot be read.");
+		return;
+	}
+
+	if(lorg::is_compiled_tree(content.view))
 	{
-		std::cout << indentation_key << "\"children\": [" << std::endl;
-		for(auto it = node.children.cbegin(); it < node.children.cend() - 1; it++)
+		lorg::CompiledTree const compiled = read_compiled_tree_to_copy(content.view);
+		std::string const error_message = (
+			compiled.has_error ?
+			compiled.error_message : check_compiled_source(file.filepath, compiled)
+		);
+		if(!error_message.empty())
 		{
-			print_json_pretty_node(**it, sorted_unit_names, indentation_value, true);
+			set_error(file, EXIT_CODE_ERROR_PARSE, error_message);
+			return;
 		}
-		print_json_pretty_node(
-			**(node.children.cend()-1), sorted_unit_names, indentation_value, false
+		file.result.has_error = false;
+		file.result.unit_definitions = compiled.unit_definitions;
+		file.result.tree = lorg::copy_tree(compiled.tree);
+		file.result.index = lorg::copy_tree_index(compiled.index);
+		return;
+	}
+
+	file.result = lorg::parse(content.view, pool);
+	file.exit_code = file.result.has_error ? EXIT_CODE_ERROR_PARSE : EXIT_CODE_OK;
+}
+
+// Load the files of a batch from `filepaths`, starting at `first_file`. A task
+// of the pool cannot wait for other tasks of it, so the files small enough to
+// be parsed on a single thread are loaded at the same time, each one by a
+// task, and the bigger ones are then parsed one after another on all the
+// threads.
+void load_batch_files(
+	std::vector<BatchFile> & files, std::vector<std::string> const & filepaths,
+	size_t first_file, lorg::ThreadPool * pool
+)
+{
+	std::vector<size_t> small_files;
+	std::vector<size_t> big_files;
+	for(size_t k = 0; k < files.size(); k++)
+	{
+		files[k].filepath = filepaths[first_file + k];
+		// The files whose size is unknown, like pipes, are loaded as small
+		// ones.
+		lorg::CompiledSource source;
+		bool const is_big = (
+			pool != nullptr &&
+			get_compiled_source(files[k].filepath, source) &&
+			lorg::is_parsed_in_chunks(source.size)
 		);
-		std::cout << indentation_key << "]" << std::endl;
+		(is_big ? big_files : small_files).push_back(k);
+	}
+	if(small_files.size() > 1)
+	{
+		lorg::run_in_parallel(
+			pool, small_files.size(),
+			[&files, &small_files](size_t k)
+			{
+				load_batch_file(files[small_files[k]], nullptr);
+			}
+		);
+	}
+	else if(small_files.size() == 1)
+	{
+		load_batch_file(files[small_files.front()], pool);
+	}
+	for(size_t k : big_files)
+	{
+		load_batch_file(files[k], pool);
 	}
+}
+
+void print_batch_file_error(lorg::Output & output, BatchFile const & file)
+{
+	// The printed files come before the error.
+	output.flush();
+	std::cerr << "\"" << file.filepath << "\": " << file.result.error_message << std::endl;
+}
 
-	if(has_sibling)
+// Print a file of a batch. In JSON, each file is a line holding its path and
+// its tree, or its error. Otherwise, its tree follows a line with its path,
+// and its error is printed to the standard error.
+void print_batch_file(
+	lorg::Output & output, BatchFile const & file, Config const & config, bool is_first
+)
+{
+	lorg::ParserResult const & result = file.result;
+	if(config.to_json)
 	{
-		std::cout << indentation << "}," << std::endl;
+		std::string escaped;
+		lorg::escape_json(file.filepath, escaped);
+		output.write("{\"file\":\"");
+		output.write(escaped);
+		if(result.has_error)
+		{
+			lorg::escape_json(result.error_message, escaped);
+			output.write("\",\"error\":\"");
+			output.write(escaped);
+			output.write("\"}\n");
+			return;
+		}
+		output.write("\",\"result\":");
 	}
 	else
 	{
-		std::cout << indentation << "}" << std::endl;
+		if(result.has_error)
+		{
+			print_batch_file_error(output, file);
+			return;
+		}
+		if(!is_first)
+		{
+			output.write('\n');
+		}
+		output.write("==> ");
+		output.write(file.filepath);
+		output.write(" <==\n");
+	}
+
+	lorg::PrinterOptions options = get_printer_options(config);
+	options.is_embedded = true;
+	lorg::Printer printer(output, options, result.unit_definitions);
+	print_selection(
+		printer, result.tree.get_view(), result.index.get_view(), config.selection,
+		config.display_total_node
+	);
+	if(config.to_json)
+	{
+		output.write("}\n");
+	}
+}
+
+// Calculate and print several files, in one process. The files are loaded on
+// a single pool of `--jobs` threads, see `load_batch_files()`, and printed in
+// order, a window of files at a time. With `--merge`, all the files are
+// loaded, then their trees are merged and printed like the tree of a single
+// file.
+int run_batch(std::vector<std::string> const & filepaths, Config const & config)
+{
+	size_t const file_count = filepaths.size();
+	size_t const thread_count = std::max<size_t>(1, get_parser_options(config).jobs);
+	std::unique_ptr<lorg::ThreadPool> pool;
+	if(thread_count > 1)
+	{
+		pool = std::make_unique<lorg::ThreadPool>(thread_count);
+	}
+
+	int exit_code = EXIT_CODE_OK;
+	lorg::Output output(stdout);
+	if(config.merge)
+	{
+		std::vector<BatchFile> files(file_count);
+		load_batch_files(files, filepaths, 0, pool.get());
+
+		// The files are the nodes of level 1 of the merged tree.
+		std::vector<lorg::MergedTree> trees;
+		for(BatchFile const & file : files)
+		{
+			if(file.result.has_error)
+			{
+				print_batch_file_error(output, file);
+				exit_code = exit_code == EXIT_CODE_OK ? file.exit_code : exit_code;
+				continue;
+			}
+			trees.push_back({file.filepath, file.result.tree.get_view(), &file.result.unit_definitions});
+		}
+		if(exit_code != EXIT_CODE_OK)
+		{
+			return exit_code;
+		}
+		lorg::ParserResult const result = lorg::merge_trees(trees, pool.get());
+		trees.clear();
+		files.clear();
+		check_unit_names_or_exit(config, result.unit_definitions);
+
+		lorg::Printer printer(output, get_printer_options(config), result.unit_definitions);
+		print_selection(
+			printer, result.tree.get_view(), result.index.get_view(), config.selection,
+			config.display_total_node
+		);
+		if(config.skip_teardown)
+		{
+			exit(EXIT_CODE_OK);
+		}
+		return EXIT_CODE_OK;
+	}
+
+	size_t const window_size = thread_count * BATCH_FILES_PER_THREAD;
+	bool is_first = true;
+	// The units of `--unit` can be missing from some files, but not from all
+	// of them.
+	std::vector<lorg::UnitDefinition> unit_definitions;
+	for(size_t window_start = 0; window_start < file_count; window_start += window_size)
+	{
+		std::vector<BatchFile> files(std::min(window_size, file_count - window_start));
+		load_batch_files(files, filepaths, window_start, pool.get());
+		for(BatchFile const & file : files)
+		{
+			print_batch_file(output, file, config, is_first);
+			is_first = is_first && file.result.has_error;
+			exit_code = exit_code == EXIT_CODE_OK ? file.exit_code : exit_code;
+			for(lorg::UnitDefinition const & unit_definition : file.result.unit_definitions)
+			{
+				unit_definitions.push_back(unit_definition);
+			}
+		}
+	}
+	std::string const error_message = is_first ? std::string() : check_unit_names(config, unit_definitions);
+	if(!error_message.empty())
+	{
+		output.flush();
+		std::cerr << error_message << std::endl;
+		exit_code = exit_code == EXIT_CODE_OK ? EXIT_CODE_ERROR_ARGUMENTS : exit_code;
 	}
+	return exit_code;
 }
 
-void print_json_pretty(
-	std::vector<lorg::Node const *> const root_nodes,
-	std::vector<std::string> const & sorted_unit_names
+#if IS_POSIX
+// The calculation of a file kept in memory between its changes.
+struct ResidentTree
+{
+	std::string filepath;
+	lorg::ParserOptions options;
+
+	// Holds the error when the last content is incorrect.
+	lorg::ParserResult result;
+	// The hashes of the node contents of the last content, to parse the next
+	// one incrementally. They are empty for compiled trees.
+	std::vector<uint64_t> node_hashes;
+};
+
+// Read and calculate the file again, parsing incrementally from the previous
+// content. Returns false if the content did not change.
+bool reload_resident_tree(ResidentTree & resident)
+{
+	Content content;
+	if(!read_file_content(resident.filepath, content))
+	{
+		std::string const error_message = "\"" + resident.filepath + "\" cannot be read.";
+		bool const has_changed = (
+			!resident.result.has_error || resident.result.error_message != error_message
+		);
+		resident.result = lorg::ParserResult();
+		resident.result.has_error = true;
+		resident.result.error_message = error_message;
+		resident.node_hashes.clear();
+		return has_changed;
+	}
+
+	if(lorg::is_compiled_tree(content.view))
+	{
+		lorg::CompiledTree const compiled = read_compiled_tree_to_copy(content.view);
+		resident.result = lorg::ParserResult();
+		resident.result.has_error = compiled.has_error;
+		resident.result.error_message = compiled.error_message;
+		if(!compiled.has_error)
+		{
+			resident.result.unit_definitions = compiled.unit_definitions;
+			resident.result.tree = lorg::copy_tree(compiled.tree);
+			resident.result.index = (
+				compiled.index.is_empty() ?
+				lorg::build_tree_index(compiled.tree) : lorg::copy_tree_index(compiled.index)
+			);
+		}
+		resident.node_hashes.clear();
+		return true;
+	}
+
+	std::vector<uint64_t> node_hashes;
+	resident.result = lorg::parse_incrementally(
+		content.view, std::move(resident.result),
+		resident.node_hashes.empty() ? nullptr : resident.node_hashes.data(),
+		node_hashes, resident.options
+	);
+	bool const has_changed = node_hashes != resident.node_hashes;
+	resident.node_hashes = std::move(node_hashes);
+	return has_changed;
+}
+
+void print_resident_tree(ResidentTree const & resident, Config const & config)
+{
+	if(resident.result.has_error)
+	{
+		std::cerr << resident.result.error_message << std::endl;
+		return;
+	}
+	std::string const error_message = check_unit_names(config, resident.result.unit_definitions);
+	if(!error_message.empty())
+	{
+		std::cerr << error_message << std::endl;
+		return;
+	}
+	lorg::Output output(stdout);
+	lorg::Printer printer(output, get_printer_options(config), resident.result.unit_definitions);
+	print_selection(
+		printer, resident.result.tree.get_view(), resident.result.index.get_view(),
+		config.selection, config.display_total_node
+	);
+}
+
+// Notice the changes of a file. On Linux, the directory of the file is watched
+// with inotify, so the file is also noticed when an editor replaces it with a
+// new one. Elsewhere, its size and modification time are checked at regular
+// intervals.
+struct FileWatcher
+{
+	std::string filepath;
+	// The inotify instance, or -1 without inotify.
+	int fd = -1;
+	// The file as it was last checked.
+	lorg::CompiledSource source;
+};
+
+void start_watching_or_exit(std::string const & filepath, FileWatcher & watcher)
+{
+	watcher.filepath = filepath;
+	get_compiled_source(filepath, watcher.source);
+#if defined(__linux__)
+	size_t const name_start = filepath.find_last_of(PATH_SEPARATORS);
+	std::string const directory = (
+		name_start == std::string::npos ? "." : filepath.substr(0, name_start + 1)
+	);
+	watcher.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	bool const is_watched = (
+		watcher.fd >= 0 &&
+		inotify_add_watch(
+			watcher.fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE
+		) >= 0
+	);
+	if(!is_watched)
+	{
+		std::cerr << "\"" << filepath << "\" cannot be watched." << std::endl;
+		exit(EXIT_CODE_ERROR_ARGUMENTS);
+	}
+#endif
+}
+
+// Returns true if the file changed since the last call, without waiting.
+bool has_file_changed(FileWatcher & watcher)
+{
+#if defined(__linux__)
+	// All the pending events are read, so the changes made at once are only
+	// seen once.
+	bool has_changed = false;
+	alignas(struct inotify_event) char events[1 << 12];
+	while(true)
+	{
+		ssize_t const size = read(watcher.fd, events, sizeof(events));
+		if(size <= 0)
+		{
+			break;
+		}
+		for(ssize_t offset = 0; offset < size;)
+		{
+			struct inotify_event const * event = reinterpret_cast<struct inotify_event const *>(
+				events + offset
+			);
+			has_changed = (
+				has_changed ||
+				(event->len > 0 && watcher.source.name.compare(event->name) == 0)
+			);
+			offset += static_cast<ssize_t>(sizeof(struct inotify_event) + event->len);
+		}
+	}
+	return has_changed;
+#else
+	lorg::CompiledSource source;
+	get_compiled_source(watcher.filepath, source);
+	bool const has_changed = (
+		source.size != watcher.source.size ||
+		source.modification_time != watcher.source.modification_time
+	);
+	watcher.source = source;
+	return has_changed;
+#endif
+}
+
+bool bind_server_socket(int fd, struct sockaddr_un const & address)
+{
+	return bind(fd, reinterpret_cast<struct sockaddr const *>(&address), sizeof(address)) == 0;
+}
+
+// Returns true if the socket file at `address` is left by a server which is
+// not running anymore, like after a crash.
+bool is_stale_socket(struct sockaddr_un const & address)
+{
+	struct stat status;
+	if(lstat(address.sun_path, &status) != 0 || !S_ISSOCK(status.st_mode))
+	{
+		return false;
+	}
+	int const fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd < 0)
+	{
+		return false;
+	}
+	bool const is_stale = (
+		connect(fd, reinterpret_cast<struct sockaddr const *>(&address), sizeof(address)) != 0 &&
+		errno == ECONNREFUSED
+	);
+	close(fd);
+	return is_stale;
+}
+
+int create_server_socket_or_exit(std::string const & socket_path)
+{
+	struct sockaddr_un address;
+	std::memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	int const fd = (
+		socket_path.size() < sizeof(address.sun_path) ? socket(AF_UNIX, SOCK_STREAM, 0) : -1
+	);
+	if(fd >= 0)
+	{
+		std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+	}
+	bool is_bound = fd >= 0 && bind_server_socket(fd, address);
+	// The socket of a server still running is never replaced.
+	if(fd >= 0 && !is_bound && errno == EADDRINUSE && is_stale_socket(address))
+	{
+		is_bound = unlink(address.sun_path) == 0 && bind_server_socket(fd, address);
+	}
+	// The clients are accepted without waiting, the server being only
+	// notified by `poll()` when one is already there.
+	bool const is_created = (
+		is_bound &&
+		listen(fd, SOMAXCONN) == 0 &&
+		fcntl(fd, F_SETFL, O_NONBLOCK) == 0
+	);
+	if(!is_created)
+	{
+		std::cerr << "\"" << socket_path << "\" cannot be created." << std::endl;
+		exit(EXIT_CODE_ERROR_ARGUMENTS);
+	}
+	return fd;
+}
+
+// A connection to the server. Its request is read and its answer is written
+// as the socket is ready, so the server never waits for a client, and a slow
+// client does not delay the others or the reloads of the file.
+struct Client
+{
+	int fd;
+	std::string request;
+	// The answer is made from the tree as soon as the request is read, so the
+	// tree can be reloaded while it is sent.
+	std::string answer;
+	size_t sent_size = 0;
+	bool is_answered = false;
+	// The client is disconnected if it does not progress until then.
+	std::chrono::steady_clock::time_point deadline;
+};
+
+void write_request_error(lorg::Output & output, std::string const & error_message)
+{
+	output.write("error: ");
+	output.write(error_message);
+	output.write('\n');
+}
+
+// Write to `answer` the answer of the request line `request`. A request is
+// made of `print` or `json`, optionally followed by a space and a path
+// pattern, see `lorg::read_path_pattern()`. `print` prints the tree like
+// without `--serve`, and `json` prints it in JSON. With a pattern, only the
+// subtrees of the matching nodes are printed, otherwise the ones selected by
+// the options. The errors are answered with a line starting with `error: `.
+void answer_request(
+	std::string const & request, ResidentTree const & resident, Config const & config,
+	std::string & answer
 )
 {
-	// NOTE(nales, 2023-01-06): This code should be refactored to avoid recursion.
+	lorg::Output output(answer);
+	size_t const command_end = request.find(' ');
+	std::string const command = request.substr(0, command_end);
+	std::vector<lorg::PathPattern> selection = config.selection;
+	std::string error_message;
+	if(command != "print" && command != "json")
+	{
+		error_message = "Unknown request \"" + request + "\".";
+	}
+	else if(command_end != std::string::npos)
+	{
+		std::string const pattern = request.substr(command_end + 1);
+		selection = {lorg::read_path_pattern(pattern)};
+		if(!lorg::is_path_pattern_correct(selection.front()))
+		{
+			error_message = "The path \"" + pattern + "\" has an empty title.";
+		}
+	}
+	if(error_message.empty() && resident.result.has_error)
+	{
+		error_message = resident.result.error_message;
+	}
+	if(error_message.empty())
+	{
+		error_message = check_unit_names(config, resident.result.unit_definitions);
+	}
+	if(!error_message.empty())
+	{
+		write_request_error(output, error_message);
+		return;
+	}
+
+	lorg::PrinterOptions options = get_printer_options(config);
+	options.to_json = options.to_json || command == "json";
+	lorg::Printer printer(output, options, resident.result.unit_definitions);
+	print_selection(
+		printer, resident.result.tree.get_view(), resident.result.index.get_view(),
+		selection, config.display_total_node
+	);
+}
 
-	std::cout << "[" << std::endl;
-	if(root_nodes.size() > 0)
+// Read what the client sent, and make its answer once its request line is
+// complete. Returns false if the client is gone.
+bool read_client_request(Client & client, ResidentTree const & resident, Config const & config)
+{
+	char buffer[256];
+	bool is_complete = false;
+	while(!is_complete)
 	{
-		for(auto it = root_nodes.cbegin(); it < root_nodes.cend() - 1; it++)
+		ssize_t const size = recv(client.fd, buffer, sizeof(buffer), 0);
+		if(size < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if(size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
 		{
-			print_json_pretty_node(**it, sorted_unit_names, INDENTATION_STEP, true);
+			return true;
 		}
-		print_json_pretty_node(
-			**(root_nodes.cend()-1), sorted_unit_names, INDENTATION_STEP, false
+		if(size < 0)
+		{
+			return false;
+		}
+		// A client closing its side without a line feed has still sent its
+		// request.
+		client.request.append(buffer, static_cast<size_t>(size));
+		is_complete = (
+			size == 0 ||
+			client.request.find('\n') != std::string::npos ||
+			client.request.size() >= MAX_REQUEST_SIZE
 		);
 	}
-	std::cout << "]" << std::endl;
+
+	std::string request = client.request.substr(0, client.request.find('\n'));
+	if(!request.empty() && request.back() == '\r')
+	{
+		request.pop_back();
+	}
+	answer_request(request, resident, config, client.answer);
+	client.is_answered = true;
+	return true;
 }
 
+// Send what the socket accepts of the answer. Returns false once it is all
+// sent, or if the client is gone.
+bool send_client_answer(Client & client)
+{
+	while(client.sent_size < client.answer.size())
+	{
+		ssize_t const size = send(
+			client.fd, client.answer.data() + client.sent_size,
+			client.answer.size() - client.sent_size, 0
+		);
+		if(size < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if(size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			return true;
+		}
+		if(size < 0)
+		{
+			return false;
+		}
+		client.sent_size += static_cast<size_t>(size);
+	}
+	return false;
+}
+
+// Accept the clients waiting for the server, without going over
+// `MAX_CLIENT_COUNT` clients.
+void accept_clients(int server, std::vector<Client> & clients)
+{
+	while(clients.size() < MAX_CLIENT_COUNT)
+	{
+		int const fd = accept(server, nullptr, nullptr);
+		if(fd < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if(fd < 0)
+		{
+			break;
+		}
+		if(fcntl(fd, F_SETFL, O_NONBLOCK) != 0)
+		{
+			close(fd);
+			continue;
+		}
+		Client client;
+		client.fd = fd;
+		client.deadline = std::chrono::steady_clock::now() + CLIENT_TIMEOUT;
+		clients.push_back(std::move(client));
+	}
+}
+
+volatile std::sig_atomic_t is_stop_requested = 0;
+
+void request_stop(int)
+{
+	is_stop_requested = 1;
+}
+
+// Keep the calculation of the file in memory, and calculate it again when the
+// file changes. With `--watch`, it is printed each time it changes. With
+// `--serve`, the requests of the socket are answered from it. Runs until
+// interrupted.
+int run_daemon(std::string const & filepath, Config const & config)
+{
+	ResidentTree resident;
+	resident.filepath = filepath;
+	resident.options = get_parser_options(config);
+	// The tree is kept to be printed many times, so its selected nodes are
+	// found from its index.
+	resident.options.build_index = true;
+	resident.result.has_error = true;
+
+	FileWatcher watcher;
+	start_watching_or_exit(filepath, watcher);
+	int const server = (
+		config.socket_path.empty() ? -1 : create_server_socket_or_exit(config.socket_path)
+	);
+	std::signal(SIGINT, request_stop);
+	std::signal(SIGTERM, request_stop);
+	if(server >= 0)
+	{
+		// A client leaving before its answer must not stop the server.
+		std::signal(SIGPIPE, SIG_IGN);
+	}
+
+	reload_resident_tree(resident);
+	if(config.watch)
+	{
+		print_resident_tree(resident, config);
+	}
+	std::vector<Client> clients;
+	std::vector<struct pollfd> fds;
+	while(!is_stop_requested)
+	{
+		fds.clear();
+		if(watcher.fd >= 0)
+		{
+			fds.push_back({watcher.fd, POLLIN, 0});
+		}
+		// With too many clients, the next ones wait to be accepted until some
+		// are done.
+		size_t const server_index = fds.size();
+		if(server >= 0 && clients.size() < MAX_CLIENT_COUNT)
+		{
+			fds.push_back({server, POLLIN, 0});
+		}
+		size_t const first_client_index = fds.size();
+		auto const now = std::chrono::steady_clock::now();
+		int timeout = watcher.fd >= 0 ? -1 : WATCH_INTERVAL_MILLISECONDS;
+		for(Client const & client: clients)
+		{
+			fds.push_back({client.fd, static_cast<short>(client.is_answered ? POLLOUT : POLLIN), 0});
+			int const client_timeout = static_cast<int>(
+				std::chrono::duration_cast<std::chrono::milliseconds>(
+					std::max(client.deadline - now, std::chrono::steady_clock::duration::zero())
+				).count()
+			) + 1;
+			timeout = timeout < 0 ? client_timeout : std::min(timeout, client_timeout);
+		}
+		if(poll(fds.data(), static_cast<nfds_t>(fds.size()), timeout) < 0)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			break;
+		}
+
+		if(has_file_changed(watcher) && reload_resident_tree(resident) && config.watch)
+		{
+			print_resident_tree(resident, config);
+		}
+
+		auto const polled_time = std::chrono::steady_clock::now();
+		for(size_t i = 0; i < clients.size(); i++)
+		{
+			Client & client = clients[i];
+			bool is_connected = polled_time < client.deadline;
+			if(is_connected && fds[first_client_index + i].revents != 0)
+			{
+				is_connected = (
+					client.is_answered ?
+					send_client_answer(client) :
+					read_client_request(client, resident, config)
+				);
+				client.deadline = polled_time + CLIENT_TIMEOUT;
+			}
+			if(!is_connected)
+			{
+				close(client.fd);
+				client.fd = -1;
+			}
+		}
+		clients.erase(
+			std::remove_if(
+				clients.begin(), clients.end(),
+				[](Client const & client) { return client.fd < 0; }
+			),
+			clients.end()
+		);
+
+		if(
+			server_index < first_client_index &&
+			(fds[server_index].revents & POLLIN) != 0
+		)
+		{
+			accept_clients(server, clients);
+		}
+	}
+
+	for(Client const & client: clients)
+	{
+		close(client.fd);
+	}
+	if(server >= 0)
+	{
+		close(server);
+		unlink(config.socket_path.c_str());
+	}
+	return EXIT_CODE_OK;
+}
+#endif
+
 int main(int argc, char* argv[])
 {
 	CommandArguments arguments = parse_command_arguments_or_exit(argc, argv);
@@ -600,18 +1719,34 @@ int main(int argc, char* argv[])
 	if(config.print_help)
 	{
 
-		std::cout << "Usage: lorg [OPTIONS]... [FILE]" << '\n';
+		std::cout << "Usage: lorg [OPTIONS]... [FILE]..." << '\n';
 		std::cout << "" << '\n';
 		std::cout << "Parse Lorg files and print the result." << '\n';
 		std::cout << "" << '\n';
-		std::cout << "When no FILE, read standard input." << '\n';
+		std::cout << "When no FILE, read standard input. Several files are printed one after the other," << '\n';
+		std::cout << "as JSON lines with --json." << '\n';
 		std::cout << "" << '\n';
 		std::cout << "Options:" << '\n';
-		std::cout << "  -h, --help      Print this help and quit." << '\n';
-		std::cout << "  -v, --version   Print the version and quit." << '\n';
-		std::cout << "  -j, --json      Print the result in JSON format." << '\n';
-		std::cout << "  -p, --prettify  Prettifies the result display." << '\n';
-		std::cout << "  -t, --total     Print a root node with the total." << '\n';
+		std::cout << "  -h, --help         Print this help and quit." << '\n';
+		std::cout << "  -v, --version      Print the version and quit." << '\n';
+		std::cout << "  -j, --json         Print the result in JSON format." << '\n';
+		std::cout << "  -p, --prettify     Prettifies the result display." << '\n';
+		std::cout << "  -t, --total        Print a root node with the total." << '\n';
+		std::cout << "      --jobs N       Use N threads, or one per core if N is 0." << '\n';
+		std::cout << "      --no-teardown  Exit without releasing the memory." << '\n';
+		std::cout << "      --stream       Use a memory bounded by the tree depth, not the file size." << '\n';
+		std::cout << "      --precision N  Print the values with N significant digits." << '\n';
+		std::cout << "      --fixed N      Print the values with N digits after the decimal point." << '\n';
+		std::cout << "      --compile      Write the result to FILE.lorgb instead of printing it." << '\n';
+		std::cout << "      --incremental  Parse only the parts of FILE changed since FILE.lorgb, and update it." << '\n';
+		std::cout << "      --select PATH  Only print the nodes matching PATH, like \"House/*\", and their children." << '\n';
+		std::cout << "      --unit NAME    Only print the units named NAME." << '\n';
+		std::cout << "      --watch        Print the result again each time FILE changes." << '\n';
+		std::cout << "      --serve PATH   Answer the requests of the Unix socket PATH from the result." << '\n';
+		std::cout << "      --stats        Print the time of each phase and what was read to the standard error." << '\n';
+		std::cout << "      --stats-json   Like --stats, in JSON." << '\n';
+		std::cout << "      --files-from LIST  Also parse the files listed in LIST, one per line, or in standard input if LIST is -." << '\n';
+		std::cout << "      --merge        Print the files as the nodes of a single tree, with a common total." << '\n';
 		std::cout << "" << '\n';
 		std::cout << "Examples:" << '\n';
 		std::cout << "  lorg -jp file.lorg" << '\n';
@@ -620,6 +1755,12 @@ int main(int argc, char* argv[])
 		std::cout << "    Print the result from file.lorg using the standard input." << '\n';
 		std::cout << "  lorg file.lorg | grep -vF \"[Calculated] [Ignored]\"" << '\n';
 		std::cout << "    Do not print unit values that are calculated and ignored." << '\n';
+		std::cout << "  lorg --select \"House/Second floor\" --unit Cost file.lorg" << '\n';
+		std::cout << "    Print the cost of the second floor of the house and of its rooms." << '\n';
+		std::cout << "  lorg --compile file.lorg && lorg file.lorgb" << '\n';
+		std::cout << "    Print the result from file.lorg without parsing it again." << '\n';
+		std::cout << "  find . -name \"*.lorg\" | lorg --jobs 0 --files-from - --merge -t" << '\n';
+		std::cout << "    Print the total of all the Lorg files of a directory." << '\n';
 		exit(0);
 	}
 	else if(config.print_version)
@@ -630,17 +1771,94 @@ int main(int argc, char* argv[])
 		exit(0);
 	}
 
+	if(arguments.is_batch)
+	{
+		std::vector<std::string> filepaths = arguments.filepaths;
+		if(!arguments.file_list_path.empty())
+		{
+			read_file_list_or_exit(arguments.file_list_path, filepaths);
+		}
+		if(filepaths.empty())
+		{
+			std::cerr << "Need a file as an argument." << std::endl;
+			exit(EXIT_CODE_ERROR_ARGUMENTS);
+		}
+		return run_batch(filepaths, config);
+	}
+	std::string const filepath = arguments.filepaths.empty() ? std::string() : arguments.filepaths.front();
+
+	if(config.watch || !config.socket_path.empty())
+	{
+#if IS_POSIX
+		return run_daemon(filepath, config);
+#else
+		std::cerr << "The options \"--watch\" and \"--serve\" are not supported on this system." << std::endl;
+		exit(EXIT_CODE_ERROR_ARGUMENTS);
+#endif
+	}
+
+	// The statistics are only measured when they are printed.
+	lorg::Stats stats;
+	lorg::Stats * const run_stats = config.print_stats ? &stats : nullptr;
+	if(config.print_stats)
+	{
+		lorg::start_counting_allocations();
+	}
+
 	// Parse the content.
 	lorg::ParserResult result;
+	if(config.stream)
+	{
+		// The content is read and printed progressively, so it is never
+		// entirely in memory.
+		std::FILE * input = stdin;
+		if(filepath.empty())
+		{
+			// Like without streaming, an empty input is not accepted.
+			int const first_character = is_stdin_from_pipe() ? std::fgetc(stdin) : EOF;
+			if(first_character == EOF)
+			{
+				std::cerr << "Need a file as an argument." << std::endl;
+				exit(EXIT_CODE_ERROR_ARGUMENTS);
+			}
+			std::ungetc(first_character, stdin);
+		}
+		else
+		{
+			input = std::fopen(filepath.c_str(), "rb");
+			if(input == NULL)
+			{
+				std::cerr << "\"" << filepath << "\" cannot be read." << std::endl;
+				exit(EXIT_CODE_ERROR_ARGUMENTS);
+			}
+		}
+		lorg::Output output(stdout);
+		result = parse_and_print_stream(input, output, config, run_stats);
+		if(input != stdin)
+		{
+			std::fclose(input);
+		}
+		if(result.has_error)
+		{
+			std::cerr << result.error_message << std::endl;
+			exit(EXIT_CODE_ERROR_PARSE);
+		}
+		print_stats(config, stats);
+		return EXIT_CODE_OK;
+	}
+	lorg::CompiledSource source;
+	// The hashes of the node contents, written with the compiled tree.
+	std::vector<uint64_t> node_hashes;
 	{
 		// NOTE(nales, 2023-01-06): We put the content variable into this scope
 		// because we get the full content of the file. The file may be very
 		// big, and we do not need the content anymore after parsing it.
-		std::string content;
-		if(arguments.filepath.empty())
+		Content content;
+		if(filepath.empty())
 		{
-			content = get_stdin_content_from_pipe();
-			if(content.empty())
+			lorg::ScopedTimer timer(run_stats, "read");
+			get_stdin_content_from_pipe(content);
+			if(content.view.empty())
 			{
 				std::cerr << "Need a file as an argument." << std::endl;
 				exit(EXIT_CODE_ERROR_ARGUMENTS);
@@ -648,59 +1866,89 @@ int main(int argc, char* argv[])
 		}
 		else
 		{
-			content = get_file_content_or_exit(arguments.filepath);
+			// The source is known before reading it, so a change while it is
+			// read is seen the next time.
+			if(config.compile || config.incremental)
+			{
+				get_compiled_source(filepath, source);
+			}
+			// A mapped file is only read from the disk when it is parsed.
+			lorg::ScopedTimer timer(run_stats, "read");
+			get_file_content_or_exit(filepath, content);
+		}
+
+		// The compiled trees are printed as they are in the content.
+		if(lorg::is_compiled_tree(content.view))
+		{
+			if(config.compile || config.incremental)
+			{
+				std::cerr << "\"" << filepath << "\" is already compiled." << std::endl;
+				exit(EXIT_CODE_ERROR_ARGUMENTS);
+			}
+			{
+				lorg::ScopedTimer timer(run_stats, "print");
+				print_compiled_tree_or_exit(filepath, content.view, config);
+			}
+			print_stats(config, stats);
+			return EXIT_CODE_OK;
+		}
+
+		lorg::ParserOptions options = get_parser_options(config);
+		// The index is compiled with the tree for the selections printed from
+		// it.
+		options.build_index = config.compile || config.incremental;
+		options.stats = run_stats;
+		if(config.incremental)
+		{
+			result = parse_incrementally(filepath, content.view, options, node_hashes);
+		}
+		else
+		{
+			result = lorg::parse(content.view, options);
+			if(config.compile)
+			{
+				lorg::ScopedTimer timer(run_stats, "hash");
+				node_hashes = lorg::hash_node_contents(content.view);
+			}
 		}
-		result = lorg::parse(content);
 	}
 	if(result.has_error)
 	{
 		std::cerr << result.error_message << std::endl;
 		exit(EXIT_CODE_ERROR_PARSE);
 	}
-	result.total_node->title = "TOTAL";
 
-	// Print the result.
-	std::vector<lorg::Node const *> root_nodes;
-	if(config.display_total_node)
+	if(config.compile || config.incremental)
 	{
-		root_nodes.push_back(result.total_node.get());
+		lorg::ScopedTimer timer(run_stats, "write compiled");
+		write_compiled_tree_or_exit(filepath, source, result, node_hashes);
 	}
-	else
+	if(!config.compile)
 	{
-		for(auto & child : result.total_node->children)
-		{
-			root_nodes.push_back(child.get());
-		}
-	}
-	std::vector<std::string> sorted_unit_names;
-	for(auto unit_pair : result.total_node->units)
-	{
-		sorted_unit_names.push_back(unit_pair.first);
+		// Print the result.
+		check_unit_names_or_exit(config, result.unit_definitions);
+		lorg::ScopedTimer timer(run_stats, "print");
+		lorg::Output output(stdout);
+		lorg::Printer printer(output, get_printer_options(config), result.unit_definitions);
+		print_selection(
+			printer, result.tree.get_view(), result.index.get_view(), config.selection,
+			config.display_total_node
+		);
 	}
-	std::sort(sorted_unit_names.begin(), sorted_unit_names.end());
 
-	if(config.to_json)
+	if(config.skip_teardown)
 	{
-		if(config.prettify)
-		{
-			print_json_pretty(root_nodes, sorted_unit_names);
-		}
-		else
-		{
-			print_json(root_nodes, sorted_unit_names);
-		}
+		// The system releases the memory of the process faster. `exit()` does
+		// not destroy the local variables, but it still flushes the outputs.
+		print_stats(config, stats);
+		exit(EXIT_CODE_OK);
 	}
-	else
+	if(config.print_stats)
 	{
-		if(config.prettify)
-		{
-			print_pretty(root_nodes, sorted_unit_names);
-		}
-		else
-		{
-			print_simple(root_nodes, sorted_unit_names);
-		}
+		// Released before the end to measure it.
+		lorg::ScopedTimer timer(run_stats, "release");
+		result = lorg::ParserResult();
 	}
-
+	print_stats(config, stats);
 	return EXIT_CODE_OK;
 }
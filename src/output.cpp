@@ -0,0 +1,755 @@
+#include "output.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <system_error>
+
+#if defined(__unix__) || (defined (__APPLE__) && defined (__MACH__))
+#define IS_POSIX 1
+#else
+#define IS_POSIX 0
+#endif
+
+#if IS_POSIX
+// Needed to write the buffer and a large string at once.
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+using namespace lorg;
+
+// A pipe is only read once the buffer is written, so it must be large enough
+// to not write too often, and small enough to be written quickly.
+constexpr size_t OUTPUT_BUFFER_SIZE = 1 << 16;
+
+// Indentation step for printing prettily JSON.
+#define INDENTATION_STEP "    "
+constexpr size_t INDENTATION_STEP_SIZE = sizeof(INDENTATION_STEP) - 1;
+
+// Enough for the largest double with `MAX_NUMBER_PRECISION` digits after the
+// decimal point.
+constexpr size_t NUMBER_BUFFER_SIZE = 420;
+
+Output::Output(std::FILE * file):
+	file(file),
+	target(nullptr),
+	buffer(new char[OUTPUT_BUFFER_SIZE]),
+	size(0),
+	capacity(OUTPUT_BUFFER_SIZE),
+	flushed_size(0)
+{
+}
+
+Output::Output(std::string & str):
+	file(nullptr),
+	target(&str),
+	buffer(new char[OUTPUT_BUFFER_SIZE]),
+	size(0),
+	capacity(OUTPUT_BUFFER_SIZE),
+	flushed_size(0)
+{
+}
+
+Output::~Output()
+{
+	flush();
+}
+
+void Output::write(size_t count, char c)
+{
+	while(count > 0)
+	{
+		if(size == capacity)
+		{
+			flush();
+		}
+		size_t const written_count = std::min(count, capacity - size);
+		std::memset(buffer.get() + size, c, written_count);
+		size += written_count;
+		count -= written_count;
+	}
+}
+
+void Output::flush()
+{
+	write_to_file(std::string_view());
+}
+
+void Output::write_to_file(std::string_view str)
+{
+	flushed_size += size + str.size();
+	if(target != nullptr)
+	{
+		target->append(buffer.get(), size);
+		target->append(str);
+		size = 0;
+		return;
+	}
+#if IS_POSIX
+	// Nothing must stay in the buffer of the file before writing to its
+	// descriptor.
+	std::fflush(file);
+	int const fd = fileno(file);
+	struct iovec parts[2];
+	parts[0].iov_base = buffer.get();
+	parts[0].iov_len = size;
+	parts[1].iov_base = const_cast<char *>(str.data());
+	parts[1].iov_len = str.size();
+	struct iovec * remaining_parts = parts;
+	int remaining_part_count = 2;
+	while(remaining_part_count > 0)
+	{
+		ssize_t written_size = writev(fd, remaining_parts, remaining_part_count);
+		if(written_size < 0)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			// Like with `std::cout`, there is nothing to do if the output
+			// cannot be written.
+			break;
+		}
+
+		// Skip what is written, which can end in the middle of a part.
+		size_t skipped_size = static_cast<size_t>(written_size);
+		while(remaining_part_count > 0 && skipped_size >= remaining_parts->iov_len)
+		{
+			skipped_size -= remaining_parts->iov_len;
+			remaining_parts++;
+			remaining_part_count--;
+		}
+		if(remaining_part_count > 0)
+		{
+			remaining_parts->iov_base = static_cast<char *>(remaining_parts->iov_base) + skipped_size;
+			remaining_parts->iov_len -= skipped_size;
+		}
+	}
+#else
+	std::fwrite(buffer.get(), 1, size, file);
+	std::fwrite(str.data(), 1, str.size(), file);
+	std::fflush(file);
+#endif
+	size = 0;
+}
+
+// The character written after `\` to escape a character in JSON, `u` for
+// the ones written as `\u00XX`, or 0 for the ones written as they are.
+constexpr std::array<char, 256> create_json_escapes()
+{
+	std::array<char, 256> escapes = {};
+	for(size_t c = 0; c < 0x20; c++)
+	{
+		escapes[c] = 'u';
+	}
+	escapes[static_cast<unsigned char>('"')] = '"';
+	escapes[static_cast<unsigned char>('\\')] = '\\';
+	escapes[static_cast<unsigned char>('\n')] = 'n';
+	escapes[static_cast<unsigned char>('\r')] = 'r';
+	escapes[static_cast<unsigned char>('\t')] = 't';
+	return escapes;
+}
+
+constexpr std::array<char, 256> JSON_ESCAPES = create_json_escapes();
+constexpr std::string_view HEXADECIMAL_DIGITS = "0123456789abcdef";
+
+// The runs of characters that need no escaping are copied at once.
+void lorg::escape_json(std::string_view str, std::string & escaped)
+{
+	escaped.clear();
+	size_t run_start = 0;
+	for(size_t i = 0; i < str.size(); i++)
+	{
+		unsigned char const c = static_cast<unsigned char>(str[i]);
+		char const escape = JSON_ESCAPES[c];
+		if(escape == 0)
+		{
+			continue;
+		}
+		escaped.append(str.data() + run_start, i - run_start);
+		escaped.push_back('\\');
+		escaped.push_back(escape);
+		if(escape == 'u')
+		{
+			escaped.append("00");
+			escaped.push_back(HEXADECIMAL_DIGITS[c >> 4]);
+			escaped.push_back(HEXADECIMAL_DIGITS[c & 0xF]);
+		}
+		run_start = i + 1;
+	}
+	escaped.append(str.data() + run_start, str.size() - run_start);
+}
+
+template<typename Float>
+std::to_chars_result write_floating_point_chars(
+	char * first, char * last, Float value, NumberFormat const & format
+)
+{
+	if(format.precision < 0)
+	{
+		return std::to_chars(first, last, value);
+	}
+	return std::to_chars(
+		first, last, value,
+		format.is_fixed ? std::chars_format::fixed : std::chars_format::general,
+		format.precision
+	);
+}
+
+template<typename Float>
+void write_floating_point_number(Output & output, Float value, NumberFormat const & format)
+{
+	char str[NUMBER_BUFFER_SIZE];
+	std::to_chars_result result = write_floating_point_chars(
+		str, str + NUMBER_BUFFER_SIZE, value, format
+	);
+	if(result.ec == std::errc())
+	{
+		output.write(std::string_view(str, static_cast<size_t>(result.ptr - str)));
+		return;
+	}
+
+	// Only a format with more than `MAX_NUMBER_PRECISION` digits does not fit,
+	// the buffer then grows until the number does.
+	std::string larger_str(NUMBER_BUFFER_SIZE, '\0');
+	while(result.ec == std::errc::value_too_large)
+	{
+		larger_str.resize(2 * larger_str.size());
+		result = write_floating_point_chars(
+			larger_str.data(), larger_str.data() + larger_str.size(), value, format
+		);
+	}
+	if(result.ec == std::errc())
+	{
+		output.write(
+			std::string_view(larger_str.data(), static_cast<size_t>(result.ptr - larger_str.data()))
+		);
+	}
+}
+
+void write_unit_value(Output & output, float value, NumberFormat const & format)
+{
+	write_floating_point_number(output, value, format);
+}
+
+void write_unit_value(Output & output, double value, NumberFormat const & format)
+{
+	write_floating_point_number(output, value, format);
+}
+
+// The fixed-point values are written from their digits, so they are exact.
+// Only with a number of significant digits are they written like doubles.
+void write_unit_value(Output & output, int64_t value, NumberFormat const & format)
+{
+	if(format.precision >= 0 && !format.is_fixed)
+	{
+		write_floating_point_number(
+			output, FixedPointUnitValues::to_double(value), format
+		);
+		return;
+	}
+
+	uint64_t magnitude = (
+		value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value)
+	);
+	int decimal_count = FIXED_POINT_DIGITS;
+	if(format.is_fixed && format.precision < FIXED_POINT_DIGITS)
+	{
+		// Rounded half away from zero.
+		uint64_t divisor = 1;
+		for(int d = format.precision; d < FIXED_POINT_DIGITS; d++)
+		{
+			divisor *= 10;
+		}
+		magnitude = (magnitude + divisor / 2) / divisor;
+		decimal_count = format.precision;
+	}
+	uint64_t decimal_scale = 1;
+	for(int d = 0; d < decimal_count; d++)
+	{
+		decimal_scale *= 10;
+	}
+
+	if(value < 0)
+	{
+		output.write('-');
+	}
+	char str[NUMBER_BUFFER_SIZE];
+	std::to_chars_result const result = std::to_chars(
+		str, str + NUMBER_BUFFER_SIZE, magnitude / decimal_scale
+	);
+	output.write(std::string_view(str, static_cast<size_t>(result.ptr - str)));
+
+	// The decimals are written with their leading zeros, and without their
+	// trailing zeros unless the format is fixed.
+	uint64_t decimals = magnitude % decimal_scale;
+	size_t digit_count = static_cast<size_t>(decimal_count);
+	while(!format.is_fixed && digit_count > 0 && decimals % 10 == 0)
+	{
+		decimals /= 10;
+		digit_count--;
+	}
+	if(digit_count == 0)
+	{
+		return;
+	}
+	str[0] = '.';
+	for(size_t d = digit_count; d > 0; d--)
+	{
+		str[d] = static_cast<char>('0' + decimals % 10);
+		decimals /= 10;
+	}
+	output.write(std::string_view(str, digit_count + 1));
+	if(format.is_fixed && format.precision > FIXED_POINT_DIGITS)
+	{
+		output.write(static_cast<size_t>(format.precision - FIXED_POINT_DIGITS), '0');
+	}
+}
+
+void lorg::write_number(Output & output, UnitValue value, NumberFormat const & format)
+{
+	write_unit_value(output, value, format);
+}
+
+void lorg::write_json_number(Output & output, UnitValue value, NumberFormat const & format)
+{
+	if(!std::isfinite(UnitValues::to_double(value)))
+	{
+		output.write("null");
+		return;
+	}
+	write_number(output, value, format);
+}
+
+inline std::string_view to_string(bool const v)
+{
+	return v ? "true" : "false";
+}
+
+void write_unit(
+	Output & output, UnitDefinition const & definition, Unit const & unit,
+	NumberFormat const & number_format
+)
+{
+	output.write("$ ");
+	output.write(definition.name);
+	output.write(": ");
+	write_number(output, unit.value, number_format);
+	if(!unit.is_real)
+	{
+		output.write(" [Calculated]");
+	}
+	if(unit.is_ignored)
+	{
+		output.write(" [Ignored]");
+	}
+}
+
+void write_json_unit(
+	Output & output, std::string_view escaped_unit_name, Unit const & unit,
+	NumberFormat const & number_format
+)
+{
+	output.write('"');
+	output.write(escaped_unit_name);
+	output.write("\":{\"name\":\"");
+	output.write(escaped_unit_name);
+	output.write("\",\"value\":");
+	write_json_number(output, unit.value, number_format);
+	output.write(",\"isReal\":");
+	output.write(to_string(unit.is_real));
+	output.write(",\"isIgnored\":");
+	output.write(to_string(unit.is_ignored));
+	output.write('}');
+}
+
+Printer::Printer(
+	Output & output, PrinterOptions const & options,
+	std::vector<UnitDefinition> const & unit_definitions
+):
+	output(output),
+	prettify(options.prettify),
+	to_json(options.to_json),
+	is_embedded(options.is_embedded),
+	number_format(options.number_format),
+	unit_definitions(unit_definitions),
+	prefix_sizes({0})
+{
+	for(size_t id = 0; id < unit_definitions.size(); id++)
+	{
+		bool const is_printed = (
+			options.unit_names.empty() ||
+			std::find(
+				options.unit_names.begin(), options.unit_names.end(),
+				unit_definitions[id].name
+			) != options.unit_names.end()
+		);
+		if(is_printed)
+		{
+			sorted_unit_ids.push_back(id);
+		}
+	}
+	if(to_json)
+	{
+		escaped_unit_names.resize(unit_definitions.size());
+		for(size_t id = 0; id < unit_definitions.size(); id++)
+		{
+			escape_json(unit_definitions[id].name, escaped_unit_names[id]);
+		}
+	}
+	std::sort(
+		sorted_unit_ids.begin(), sorted_unit_ids.end(),
+		[&unit_definitions](size_t const & a, size_t const & b)
+		{
+			return unit_definitions[a].name < unit_definitions[b].name;
+		}
+	);
+}
+
+void open_simple_node(Printer & printer, PrintedNode const & node)
+{
+	Output & output = printer.output;
+	size_t const indentation_size = 2 * (node.level - 1);
+
+	// Print the title.
+	output.write(indentation_size, ' ');
+	output.write(node.level, NODE_DEFINITION_CHARACTER);
+	output.write(' ');
+	output.write(node.title);
+	output.write('\n');
+
+	// Print the units.
+	for(size_t const & id : printer.sorted_unit_ids)
+	{
+		output.write(indentation_size + 2, ' ');
+		write_unit(
+			output, printer.unit_definitions[id], node.units[id],
+			printer.number_format
+		);
+		output.write('\n');
+	}
+}
+
+void open_pretty_node(Printer & printer, PrintedNode const & node)
+{
+	Output & output = printer.output;
+
+	// Print the title.
+	printer.prefix_sizes.resize(node.level);
+	size_t const prefix_from_parent_size = printer.prefix_sizes.back();
+	std::string_view const prefix_from_parent = std::string_view(printer.prefixes).substr(
+		0, prefix_from_parent_size
+	);
+	if(node.level > 1)
+	{
+		output.write(prefix_from_parent);
+		output.write(node.has_next_sibling ? "├── " : "└── ");
+	}
+	output.write(node.title);
+	output.write('\n');
+
+	// Set up the prefix for the children.
+	printer.prefixes.resize(prefix_from_parent_size);
+	if(node.level > 1)
+	{
+		printer.prefixes.append(node.has_next_sibling ? "│   " : "    ");
+	}
+	std::string_view const prefix_for_next_lines = printer.prefixes;
+
+	// Print the units.
+	for(size_t const & id : printer.sorted_unit_ids)
+	{
+		output.write(prefix_for_next_lines);
+		output.write(node.has_children ? "│ " : "  ");
+		write_unit(
+			output, printer.unit_definitions[id], node.units[id],
+			printer.number_format
+		);
+		output.write('\n');
+	}
+
+	printer.prefix_sizes.push_back(printer.prefixes.size());
+}
+
+void open_json_node(Printer & printer, PrintedNode const & node)
+{
+	Output & output = printer.output;
+
+	// Print title.
+	output.write("{\"title\":\"");
+	escape_json(node.title, printer.escaped_title);
+	output.write(printer.escaped_title);
+	output.write('"');
+
+	// Print the units.
+	output.write(",\"units\":{");
+	{
+		// Needed to manage the last `,`.
+		bool is_first = true;
+		for(size_t const & id : printer.sorted_unit_ids)
+		{
+			if(!is_first)
+			{
+				output.write(',');
+			}
+			write_json_unit(
+				output, printer.escaped_unit_names[id], node.units[id],
+				printer.number_format
+			);
+			is_first = false;
+		}
+	}
+	output.write('}');
+
+	// The children are printed next.
+	output.write(",\"children\":[");
+}
+
+void close_json_node(Printer & printer, OpenNode const & node)
+{
+	printer.output.write("]}");
+	if(node.has_next_sibling)
+	{
+		printer.output.write(',');
+	}
+}
+
+// Write the indentation of the JSON object of a node of level `level`,
+// followed by `extra_step_count` more steps.
+void write_json_pretty_indentation(
+	Output & output, size_t level, size_t extra_step_count
+)
+{
+	output.write((2 * level - 1 + extra_step_count) * INDENTATION_STEP_SIZE, ' ');
+}
+
+void open_json_pretty_node(Printer & printer, PrintedNode const & node)
+{
+	Output & output = printer.output;
+	size_t const level = node.level;
+
+	write_json_pretty_indentation(output, level, 0);
+	output.write("{\n");
+
+	// Print title.
+	write_json_pretty_indentation(output, level, 1);
+	output.write("\"title\": \"");
+	escape_json(node.title, printer.escaped_title);
+	output.write(printer.escaped_title);
+	output.write("\",\n");
+
+	// Print the units.
+	write_json_pretty_indentation(output, level, 1);
+	if(printer.sorted_unit_ids.empty())
+	{
+		output.write("\"units\": {},\n");
+	}
+	else
+	{
+		output.write("\"units\": {\n");
+		// Needed to manage the last `},`.
+		bool is_first = true;
+		for(size_t const & id : printer.sorted_unit_ids)
+		{
+			Unit const & unit = node.units[id];
+			std::string_view const escaped_unit_name = printer.escaped_unit_names[id];
+
+			if(!is_first)
+			{
+				// Closing the last sibling unit JSON print.
+				write_json_pretty_indentation(output, level, 2);
+				output.write("},\n");
+			}
+			is_first = false;
+
+			write_json_pretty_indentation(output, level, 2);
+			output.write('"');
+			output.write(escaped_unit_name);
+			output.write("\": {\n");
+			write_json_pretty_indentation(output, level, 3);
+			output.write("\"name\": \"");
+			output.write(escaped_unit_name);
+			output.write("\",\n");
+			write_json_pretty_indentation(output, level, 3);
+			output.write("\"value\": ");
+			write_json_number(output, unit.value, printer.number_format);
+			output.write(",\n");
+			write_json_pretty_indentation(output, level, 3);
+			output.write("\"isReal\": ");
+			output.write(to_string(unit.is_real));
+			output.write(",\n");
+			write_json_pretty_indentation(output, level, 3);
+			output.write("\"isIgnored\": ");
+			output.write(to_string(unit.is_ignored));
+			output.write('\n');
+		}
+		// Closing the last sibling unit JSON print.
+		write_json_pretty_indentation(output, level, 2);
+		output.write("}\n");
+		write_json_pretty_indentation(output, level, 1);
+		output.write("},\n");
+	}
+
+	// The children are printed next.
+	write_json_pretty_indentation(output, level, 1);
+	output.write(node.has_children ? "\"children\": [\n" : "\"children\": []\n");
+}
+
+void close_json_pretty_node(Printer & printer, OpenNode const & node)
+{
+	Output & output = printer.output;
+	if(node.has_children)
+	{
+		write_json_pretty_indentation(output, node.level, 1);
+		output.write("]\n");
+	}
+	write_json_pretty_indentation(output, node.level, 0);
+	output.write(node.has_next_sibling ? "},\n" : "}\n");
+}
+
+// Print the start of a node, up to its children.
+void open_node(Printer & printer, PrintedNode const & node)
+{
+	if(printer.to_json)
+	{
+		if(printer.prettify)
+		{
+			open_json_pretty_node(printer, node);
+		}
+		else
+		{
+			open_json_node(printer, node);
+		}
+	}
+	else if(printer.prettify)
+	{
+		open_pretty_node(printer, node);
+	}
+	else
+	{
+		open_simple_node(printer, node);
+	}
+}
+
+// Print the end of a node, after its last descendant. Only JSON has
+// something to print.
+void close_node(Printer & printer, OpenNode const & node)
+{
+	if(printer.to_json)
+	{
+		if(printer.prettify)
+		{
+			close_json_pretty_node(printer, node);
+		}
+		else
+		{
+			close_json_node(printer, node);
+		}
+	}
+}
+
+// Close the open nodes whose level is at least `level`.
+void close_nodes(Printer & printer, size_t level)
+{
+	while(printer.open_nodes.size() >= level && !printer.open_nodes.empty())
+	{
+		close_node(printer, printer.open_nodes.back());
+		printer.open_nodes.pop_back();
+	}
+}
+
+void lorg::start_printing(Printer & printer)
+{
+	if(printer.to_json)
+	{
+		printer.output.write(printer.prettify ? "[\n" : "[");
+	}
+}
+
+void lorg::print_node(Printer & printer, PrintedNode const & node)
+{
+	// The nodes are in pre-order, so the previous nodes of the same level or
+	// below are complete.
+	close_nodes(printer, node.level);
+	open_node(printer, node);
+	printer.open_nodes.push_back(
+		OpenNode{node.level, node.has_children, node.has_next_sibling}
+	);
+}
+
+void lorg::finish_printing(Printer & printer)
+{
+	close_nodes(printer, 1);
+	if(printer.to_json)
+	{
+		printer.output.write(printer.is_embedded ? "]" : "]\n");
+	}
+	printer.output.flush();
+}
+
+// Print the nodes from `first` to `last` excluded, which must be whole
+// sibling subtrees. The nodes of depth `first_depth` are printed at level 1.
+// `is_followed` tells whether other nodes of level 1 are printed after them.
+// `units` is only used to hold the units of a node, of which only the printed
+// ones are read.
+void print_node_range(
+	Printer & printer, TreeView const & tree, size_t first, size_t last,
+	size_t first_depth, bool is_followed, std::vector<Unit> & units
+)
+{
+	units.resize(tree.unit_count);
+	for(size_t i = first; i < last; i++)
+	{
+		for(size_t const & id : printer.sorted_unit_ids)
+		{
+			units[id] = tree.get_unit(i, id);
+		}
+		size_t const depth = tree.depths[i];
+		bool const has_next_sibling = (
+			depth == first_depth ?
+			tree.subtree_ends[i] < last || is_followed :
+			tree.subtree_ends[i] < tree.subtree_ends[tree.parents[i]]
+		);
+		PrintedNode const node = {
+			depth + 1 - first_depth,
+			tree.has_children(i),
+			has_next_sibling,
+			tree.get_title(i),
+			units
+		};
+		print_node(printer, node);
+	}
+}
+
+void lorg::print_tree(Printer & printer, TreeView const & tree, bool display_total_node)
+{
+	// The total node is of depth 0, the nodes of level 1 are of depth 1.
+	size_t const first_depth = display_total_node ? 0 : 1;
+	std::vector<Unit> units;
+	start_printing(printer);
+	print_node_range(
+		printer, tree, get_first_printed_node(display_total_node), tree.node_count,
+		first_depth, false, units
+	);
+	finish_printing(printer);
+}
+
+void lorg::print_subtrees(
+	Printer & printer, TreeView const & tree, std::vector<size_t> const & roots
+)
+{
+	std::vector<Unit> units;
+	start_printing(printer);
+	for(size_t k = 0; k < roots.size(); k++)
+	{
+		size_t const root = roots[k];
+		print_node_range(
+			printer, tree, root, tree.subtree_ends[root], tree.depths[root],
+			k + 1 < roots.size(), units
+		);
+	}
+	finish_printing(printer);
+}
@@ -0,0 +1,203 @@
+#ifndef LORG_OUTPUT_HPP
+#define LORG_OUTPUT_HPP
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "lorg.hpp"
+
+namespace lorg
+{
+
+// Write to a file through a large buffer, which is only written when it is
+// full or when `flush()` is called. The writes bigger than the free part of
+// the buffer are written with the buffer in a single system call, without
+// being copied.
+class Output
+{
+public:
+	explicit Output(std::FILE * file);
+	// Append to `str` instead of writing to a file, to send it later.
+	explicit Output(std::string & str);
+	// Flush the buffer.
+	~Output();
+
+	Output(Output const &) = delete;
+	Output & operator=(Output const &) = delete;
+
+	void write(std::string_view str)
+	{
+		if(str.size() > capacity - size)
+		{
+			write_to_file(str);
+			return;
+		}
+		std::memcpy(buffer.get() + size, str.data(), str.size());
+		size += str.size();
+	}
+
+	void write(char c)
+	{
+		if(size == capacity)
+		{
+			flush();
+		}
+		buffer[size] = c;
+		size++;
+	}
+
+	// Write `count` times the character `c`.
+	void write(size_t count, char c);
+
+	void flush();
+
+	// The number of bytes written since the output was created, the ones
+	// still in the buffer included.
+	size_t get_written_size() const noexcept
+	{
+		return flushed_size + size;
+	}
+
+private:
+	// Write the buffer followed by `str` to the file, and empty the buffer.
+	void write_to_file(std::string_view str);
+
+	std::FILE * file;
+	std::string * target;
+	std::unique_ptr<char[]> buffer;
+	size_t size;
+	size_t capacity;
+	size_t flushed_size;
+};
+
+// How the unit values are written. By default, the shortest number that reads
+// back as the same value is written, which is all the decimals of the
+// fixed-point values. With a precision, `precision` significant digits are
+// written, or `precision` digits after the decimal point when `is_fixed` is
+// true.
+struct NumberFormat
+{
+	int precision = -1;
+	bool is_fixed = false;
+};
+
+constexpr int MAX_NUMBER_PRECISION = 100;
+
+// The values that are not finite are written as `inf`, `-inf` or `nan`.
+void write_number(Output & output, UnitValue value, NumberFormat const & format);
+
+// Like `write_number()`, but the values that are not finite, which JSON
+// cannot represent, are written as `null`.
+void write_json_number(Output & output, UnitValue value, NumberFormat const & format);
+
+// Set `escaped` to `str` escaped for a JSON string, without the quotes.
+void escape_json(std::string_view str, std::string & escaped);
+
+struct PrinterOptions
+{
+	bool prettify = false;
+	bool to_json = false;
+	NumberFormat number_format;
+	// Only the units with these names are printed, or all of them if it is
+	// empty.
+	std::vector<std::string> unit_names;
+	// In JSON, do not end the tree with a line feed, to print it inside
+	// another value.
+	bool is_embedded = false;
+};
+
+// A node to print. The nodes are given to the printer in pre-order.
+struct PrintedNode
+{
+	// The printed nodes of level 1 are the roots of the printed tree.
+	size_t level;
+	bool has_children;
+	bool has_next_sibling;
+	std::string_view title;
+
+	// The units of the node indexed by their unit ID.
+	std::vector<Unit> const & units;
+};
+
+// A node whose start is printed, and whose end is printed after its last
+// descendant.
+struct OpenNode
+{
+	size_t level;
+	bool has_children;
+	bool has_next_sibling;
+};
+
+// Print the nodes one by one, so nothing but the current branch has to be
+// kept, whatever the size of the tree. Each node is printed as two events:
+// its start when it is given, and its end when the next node not in its
+// subtree is given. Without recursion, the depth of the tree is only limited
+// by the memory.
+struct Printer
+{
+	Output & output;
+	bool prettify;
+	bool to_json;
+	bool is_embedded;
+	NumberFormat number_format;
+
+	std::vector<UnitDefinition> unit_definitions;
+
+	// The printed units in the order of their names.
+	std::vector<size_t> sorted_unit_ids;
+
+	// For JSON, the unit names are escaped once for all the nodes, and the
+	// titles are escaped into the same buffer.
+	std::vector<std::string> escaped_unit_names;
+	std::string escaped_title;
+
+	// For the pretty format, the prefix of the lines of the children of the
+	// last node printed at the level `l` is the start of `prefixes` of size
+	// `prefix_sizes[l - 1]`. The prefix of a node always starts with the one
+	// of its parent, so they are all in the same string.
+	std::string prefixes;
+	std::vector<size_t> prefix_sizes;
+
+	// The printed nodes whose end is not printed yet, which are the nodes of
+	// the current branch. The node `k` is of level `k + 1`.
+	std::vector<OpenNode> open_nodes;
+
+	Printer(
+		Output & output, PrinterOptions const & options,
+		std::vector<UnitDefinition> const & unit_definitions
+	);
+};
+
+void start_printing(Printer & printer);
+void print_node(Printer & printer, PrintedNode const & node);
+// Close the printed nodes and flush the output.
+void finish_printing(Printer & printer);
+
+// The printed nodes are the children of the total node, or the total node
+// itself when `display_total_node` is true. Their level is 1.
+inline size_t get_first_printed_node(bool display_total_node)
+{
+	return display_total_node ? 0 : 1;
+}
+
+inline size_t get_printed_level(size_t depth, bool display_total_node)
+{
+	return depth + (display_total_node ? 1 : 0);
+}
+
+// Print all the nodes of the tree.
+void print_tree(Printer & printer, TreeView const & tree, bool display_total_node);
+
+// Print the nodes `roots` and their descendants. The roots are printed at
+// level 1, as siblings. They must be in pre-order, none in the subtree of
+// another.
+void print_subtrees(
+	Printer & printer, TreeView const & tree, std::vector<size_t> const & roots
+);
+}
+
+#endif
@@ -0,0 +1,232 @@
+#include "stats.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+
+#if defined(__unix__) || (defined (__APPLE__) && defined (__MACH__))
+// Needed to know the peak resident size.
+#include <sys/resource.h>
+#define HAS_RUSAGE 1
+#else
+#define HAS_RUSAGE 0
+#endif
+
+using namespace lorg;
+
+#if !defined(LORG_NO_STATS)
+// Until the allocations are counted, `new` only checks this flag.
+std::atomic<bool> are_allocations_counted(false);
+std::atomic<uint64_t> counted_allocation_count(0);
+std::atomic<uint64_t> counted_allocated_size(0);
+
+void * operator new(size_t size)
+{
+	if(are_allocations_counted.load(std::memory_order_relaxed))
+	{
+		counted_allocation_count.fetch_add(1, std::memory_order_relaxed);
+		counted_allocated_size.fetch_add(size, std::memory_order_relaxed);
+	}
+	// `malloc(0)` may return null, which `new` cannot.
+	void * const pointer = std::malloc(size == 0 ? 1 : size);
+	if(pointer == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return pointer;
+}
+
+void * operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+// The `std::nothrow_t` versions are replaced too, so all the memory freed by
+// the `delete` above comes from `std::malloc()`, and their allocations are
+// counted.
+void * operator new(size_t size, std::nothrow_t const &) noexcept
+{
+	try
+	{
+		return operator new(size);
+	}
+	catch(std::bad_alloc const &)
+	{
+		return nullptr;
+	}
+}
+
+void * operator new[](size_t size, std::nothrow_t const &) noexcept
+{
+	return operator new(size, std::nothrow);
+}
+
+void operator delete(void * pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void * pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void * pointer, size_t) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void * pointer, size_t) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void * pointer, std::nothrow_t const &) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void * pointer, std::nothrow_t const &) noexcept
+{
+	std::free(pointer);
+}
+#endif
+
+void lorg::start_counting_allocations() noexcept
+{
+#if !defined(LORG_NO_STATS)
+	are_allocations_counted.store(true, std::memory_order_relaxed);
+#endif
+}
+
+AllocationCounts lorg::get_allocation_counts() noexcept
+{
+	AllocationCounts counts;
+#if !defined(LORG_NO_STATS)
+	counts.count = counted_allocation_count.load(std::memory_order_relaxed);
+	counts.size = counted_allocated_size.load(std::memory_order_relaxed);
+#endif
+	return counts;
+}
+
+uint64_t lorg::get_peak_resident_size() noexcept
+{
+#if HAS_RUSAGE
+	struct rusage usage;
+	if(getrusage(RUSAGE_SELF, &usage) != 0 || usage.ru_maxrss < 0)
+	{
+		return 0;
+	}
+	// Linux gives kilobytes, macOS bytes.
+#if defined(__APPLE__)
+	return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+	return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#else
+	return 0;
+#endif
+}
+
+#if !defined(LORG_NO_STATS)
+ScopedTimer::ScopedTimer(Stats * stats, std::string_view phase) noexcept:
+	stats(stats),
+	phase(phase)
+{
+	if(stats != nullptr)
+	{
+		start_allocations = get_allocation_counts();
+		start = std::chrono::steady_clock::now();
+	}
+}
+
+ScopedTimer::~ScopedTimer()
+{
+	if(stats == nullptr)
+	{
+		return;
+	}
+	std::chrono::duration<double> const elapsed = (
+		std::chrono::steady_clock::now() - start
+	);
+	AllocationCounts const allocations = get_allocation_counts();
+
+	PhaseStats * phase_stats = nullptr;
+	for(PhaseStats & measured_phase : stats->phases)
+	{
+		if(measured_phase.name == phase)
+		{
+			phase_stats = &measured_phase;
+		}
+	}
+	if(phase_stats == nullptr)
+	{
+		stats->phases.emplace_back();
+		phase_stats = &stats->phases.back();
+		phase_stats->name = phase;
+	}
+	phase_stats->seconds += elapsed.count();
+	phase_stats->allocation_count += allocations.count - start_allocations.count;
+	phase_stats->allocated_size += allocations.size - start_allocations.size;
+}
+#endif
+
+void lorg::finish_stats(Stats & stats) noexcept
+{
+	AllocationCounts const allocations = get_allocation_counts();
+	stats.allocation_count = allocations.count;
+	stats.allocated_size = allocations.size;
+	stats.peak_resident_size = get_peak_resident_size();
+}
+
+std::string lorg::format_stats(Stats const & stats, bool to_json)
+{
+	double total_seconds = 0.0;
+	for(PhaseStats const & phase : stats.phases)
+	{
+		total_seconds += phase.seconds;
+	}
+
+	std::ostringstream str;
+	if(to_json)
+	{
+		// The names have no characters to escape.
+		str << "{\"phases\": [";
+		for(size_t p = 0; p < stats.phases.size(); p++)
+		{
+			PhaseStats const & phase = stats.phases[p];
+			str << (p == 0 ? "" : ", ");
+			str << "{\"name\": \"" << phase.name << "\", \"seconds\": " << phase.seconds;
+			str << ", \"allocations\": " << phase.allocation_count;
+			str << ", \"allocated_bytes\": " << phase.allocated_size << "}";
+		}
+		str << "], \"seconds\": " << total_seconds;
+		str << ", \"bytes\": " << stats.byte_count;
+		str << ", \"lines\": " << stats.line_count;
+		str << ", \"nodes\": " << stats.node_count;
+		str << ", \"units\": " << stats.unit_count;
+		str << ", \"peak_depth\": " << stats.peak_depth;
+		str << ", \"allocations\": " << stats.allocation_count;
+		str << ", \"allocated_bytes\": " << stats.allocated_size;
+		str << ", \"peak_resident_bytes\": " << stats.peak_resident_size << "}" << '\n';
+		return str.str();
+	}
+
+	for(PhaseStats const & phase : stats.phases)
+	{
+		str << phase.name << ": " << phase.seconds << " s, ";
+		str << phase.allocation_count << " allocations of ";
+		str << phase.allocated_size << " bytes" << '\n';
+	}
+	str << "total: " << total_seconds << " s" << '\n';
+	str << "bytes: " << stats.byte_count << '\n';
+	str << "lines: " << stats.line_count << '\n';
+	str << "nodes: " << stats.node_count << '\n';
+	str << "units: " << stats.unit_count << '\n';
+	str << "peak depth: " << stats.peak_depth << '\n';
+	str << "allocations: " << stats.allocation_count << " of ";
+	str << stats.allocated_size << " bytes" << '\n';
+	str << "peak resident size: " << stats.peak_resident_size << " bytes" << '\n';
+	return str.str();
+}
@@ -0,0 +1,101 @@
+#ifndef LORG_STATS_HPP
+#define LORG_STATS_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lorg
+{
+
+// Define `LORG_NO_STATS` to compile the statistics out: the timers and the
+// counters then do nothing, and the allocations are not counted.
+#if defined(LORG_NO_STATS)
+constexpr bool ARE_STATS_ENABLED = false;
+#else
+constexpr bool ARE_STATS_ENABLED = true;
+#endif
+
+// The time spent in a phase of a run, and what it allocated.
+struct PhaseStats
+{
+	std::string name;
+	double seconds = 0.0;
+	uint64_t allocation_count = 0;
+	uint64_t allocated_size = 0;
+};
+
+// What a run did, to know where its time went. The counters are 0 when they
+// were not measured.
+struct Stats
+{
+	// In the order of their first measure. A phase measured several times
+	// holds the sum of its measures.
+	std::vector<PhaseStats> phases;
+
+	uint64_t byte_count = 0;
+	uint64_t line_count = 0;
+	// The total node is not counted.
+	uint64_t node_count = 0;
+	// The real units, the ones defined in the content.
+	uint64_t unit_count = 0;
+	uint64_t peak_depth = 0;
+
+	// Since `start_counting_allocations()`.
+	uint64_t allocation_count = 0;
+	uint64_t allocated_size = 0;
+	uint64_t peak_resident_size = 0;
+};
+
+// Count the allocations made with `new` from now on, by all the threads.
+void start_counting_allocations() noexcept;
+
+struct AllocationCounts
+{
+	uint64_t count = 0;
+	uint64_t size = 0;
+};
+
+AllocationCounts get_allocation_counts() noexcept;
+
+// The most memory the process had in RAM, in bytes, or 0 if it is unknown.
+uint64_t get_peak_resident_size() noexcept;
+
+// Add the time spent and the allocations made in its scope to a phase of the
+// statistics, unless they are null.
+#if defined(LORG_NO_STATS)
+class ScopedTimer
+{
+public:
+	ScopedTimer(Stats *, std::string_view) noexcept
+	{
+	}
+};
+#else
+class ScopedTimer
+{
+public:
+	ScopedTimer(Stats * stats, std::string_view phase) noexcept;
+	~ScopedTimer();
+
+	ScopedTimer(ScopedTimer const &) = delete;
+	ScopedTimer & operator=(ScopedTimer const &) = delete;
+
+private:
+	Stats * stats;
+	std::string_view phase;
+	std::chrono::steady_clock::time_point start;
+	AllocationCounts start_allocations;
+};
+#endif
+
+// Set the allocation counters and the peak resident size of the statistics.
+void finish_stats(Stats & stats) noexcept;
+
+// A line per phase and per counter, or a JSON object on a single line.
+std::string format_stats(Stats const & stats, bool to_json);
+}
+
+#endif
@@ -0,0 +1,159 @@
+#include "thread_pool.hpp"
+
+using namespace lorg;
+
+namespace
+{
+// The pool and the worker index of the current thread. The thread calling
+// `wait()` uses the index 0.
+thread_local ThreadPool const * current_pool = nullptr;
+thread_local size_t current_worker_index = 0;
+}
+
+ThreadPool::ThreadPool(size_t thread_count):
+	pending_task_count(0),
+	queued_task_count(0),
+	is_stopping(false)
+{
+	if(thread_count == 0)
+	{
+		thread_count = 1;
+	}
+	for(size_t i = 0; i < thread_count; i++)
+	{
+		workers.push_back(std::make_unique<Worker>());
+	}
+	for(size_t i = 1; i < thread_count; i++)
+	{
+		threads.emplace_back(&ThreadPool::work, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+		is_stopping = true;
+	}
+	wake_up.notify_all();
+	for(std::thread & thread : threads)
+	{
+		thread.join();
+	}
+}
+
+size_t ThreadPool::get_thread_count() const noexcept
+{
+	return workers.size();
+}
+
+size_t ThreadPool::get_current_worker_index() const noexcept
+{
+	return current_pool == this ? current_worker_index : 0;
+}
+
+void ThreadPool::spawn(std::function<void()> task)
+{
+	pending_task_count++;
+	{
+		Worker & worker = *(workers[get_current_worker_index()]);
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		worker.tasks.push_back(std::move(task));
+	}
+	{
+		// Changing the count while holding the lock avoids a sleeping thread
+		// missing the notification.
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+		queued_task_count++;
+	}
+	wake_up.notify_one();
+}
+
+bool ThreadPool::run_one_task(size_t worker_index)
+{
+	std::function<void()> task;
+	for(size_t n = 0; n < workers.size() && !task; n++)
+	{
+		// Start with the own queue of the thread.
+		Worker & worker = *(workers[(worker_index + n) % workers.size()]);
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		if(worker.tasks.empty())
+		{
+			continue;
+		}
+		if(n == 0)
+		{
+			task = std::move(worker.tasks.back());
+			worker.tasks.pop_back();
+		}
+		else
+		{
+			task = std::move(worker.tasks.front());
+			worker.tasks.pop_front();
+		}
+	}
+	if(!task)
+	{
+		return false;
+	}
+	queued_task_count--;
+	task();
+
+	if(--pending_task_count == 0)
+	{
+		// Wake up the thread waiting for all the tasks.
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+		wake_up.notify_all();
+	}
+	return true;
+}
+
+void ThreadPool::work(size_t worker_index)
+{
+	current_pool = this;
+	current_worker_index = worker_index;
+	while(true)
+	{
+		if(run_one_task(worker_index))
+		{
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(sleep_mutex);
+		wake_up.wait(
+			lock,
+			[this]()
+			{
+				return is_stopping || queued_task_count > 0;
+			}
+		);
+		if(is_stopping)
+		{
+			return;
+		}
+	}
+}
+
+void ThreadPool::wait()
+{
+	ThreadPool const * const previous_pool = current_pool;
+	size_t const previous_worker_index = current_worker_index;
+	current_pool = this;
+	current_worker_index = 0;
+	while(pending_task_count > 0)
+	{
+		if(run_one_task(0))
+		{
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(sleep_mutex);
+		wake_up.wait(
+			lock,
+			[this]()
+			{
+				return queued_task_count > 0 || pending_task_count == 0;
+			}
+		);
+	}
+	current_pool = previous_pool;
+	current_worker_index = previous_worker_index;
+}
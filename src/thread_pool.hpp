@@ -0,0 +1,91 @@
+#ifndef LORG_THREAD_POOL_HPP
+#define LORG_THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lorg
+{
+
+// Run tasks on a fixed number of threads, the thread calling `wait()`
+// included. Each thread has its own queue of tasks. A thread runs the last
+// task it added to its queue first, and when its queue is empty it steals the
+// oldest task of another thread. Tasks can add other tasks while running.
+class ThreadPool
+{
+public:
+	explicit ThreadPool(size_t thread_count);
+	~ThreadPool();
+
+	ThreadPool(ThreadPool const &) = delete;
+	ThreadPool & operator=(ThreadPool const &) = delete;
+
+	size_t get_thread_count() const noexcept;
+
+	// Add a task to the queue of the current thread.
+	void spawn(std::function<void()> task);
+
+	// Help running the tasks until all of them are done, including the ones
+	// added meanwhile.
+	void wait();
+
+private:
+	struct Worker
+	{
+		std::mutex mutex;
+		std::deque<std::function<void()>> tasks;
+	};
+
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::vector<std::thread> threads;
+
+	// The tasks added but not finished yet, and the ones still in a queue.
+	std::atomic<size_t> pending_task_count;
+	std::atomic<size_t> queued_task_count;
+
+	// Used to sleep when there is no task to run.
+	std::mutex sleep_mutex;
+	std::condition_variable wake_up;
+	bool is_stopping;
+
+	// Returns false if there was no task to run.
+	bool run_one_task(size_t worker_index);
+
+	void work(size_t worker_index);
+
+	size_t get_current_worker_index() const noexcept;
+};
+
+// Run `task(i)` for all `i` in `[0, task_count)` and wait for all of them.
+// Without pool, the tasks are run by the calling thread.
+template<typename Task>
+void run_in_parallel(ThreadPool * pool, size_t task_count, Task const & task)
+{
+	if(pool == nullptr || task_count <= 1)
+	{
+		for(size_t i = 0; i < task_count; i++)
+		{
+			task(i);
+		}
+		return;
+	}
+	for(size_t i = 0; i < task_count; i++)
+	{
+		pool->spawn(
+			[i, &task]()
+			{
+				task(i);
+			}
+		);
+	}
+	pool->wait();
+}
+}
+
+#endif
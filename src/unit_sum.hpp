@@ -0,0 +1,182 @@
+#ifndef LORG_UNIT_SUM_HPP
+#define LORG_UNIT_SUM_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "unit_value.hpp"
+
+// The vector kernel is written with the vector extensions of GCC and Clang, so
+// the compiler picks the instructions of the target. The vectors have 128 bits,
+// which all the SIMD instruction sets have. They only hold two values of 64
+// bits, which is slower than the scalar kernel, so only the floats use it.
+// Define `LORG_NO_SIMD` to use the scalar kernel.
+#if !defined(LORG_NO_SIMD) && defined(__GNUC__) && \
+	!defined(LORG_DOUBLE_UNIT_VALUES) && !defined(LORG_FIXED_POINT_UNIT_VALUES)
+#define LORG_UNIT_SUM_VECTOR 1
+#endif
+
+namespace lorg
+{
+
+// Add the units of a child to the units of its parent, except the units real
+// in the parent. The bit `id % 64` of `real_mask[id / 64]` is set when the
+// unit `id` is real in the parent.
+//
+// Each unit is added exactly like `Values::add(values[id], child_values[id])`,
+// so both kernels give the same results.
+template<typename Values>
+inline void add_child_units_scalar(
+	typename Values::Value * values, typename Values::Value const * child_values,
+	uint64_t const * real_mask, size_t unit_count
+)
+{
+	for(size_t id = 0; id < unit_count; id++)
+	{
+		if(((real_mask[id / 64] >> (id % 64)) & 1) == 0)
+		{
+			Values::add(values[id], child_values[id]);
+		}
+	}
+}
+
+#if defined(LORG_UNIT_SUM_VECTOR)
+constexpr size_t UNIT_SUM_VECTOR_BYTES = 16;
+
+// The vectors of values added by the vector kernel, and the masks of the same
+// size.
+template<typename Value>
+struct UnitSumVector;
+
+template<>
+struct UnitSumVector<float>
+{
+	typedef float Values __attribute__((vector_size(UNIT_SUM_VECTOR_BYTES)));
+	typedef int32_t MaskLane;
+	typedef MaskLane Mask __attribute__((vector_size(UNIT_SUM_VECTOR_BYTES)));
+};
+
+template<typename Values>
+inline void add_child_units_vector(
+	typename Values::Value * values, typename Values::Value const * child_values,
+	uint64_t const * real_mask, size_t unit_count
+)
+{
+	typedef UnitSumVector<typename Values::Value> Vector;
+	typedef typename Vector::Values VectorValues;
+	typedef typename Vector::Mask VectorMask;
+	constexpr size_t vector_size = UNIT_SUM_VECTOR_BYTES / sizeof(typename Values::Value);
+	constexpr uint64_t vector_bits = (uint64_t(1) << vector_size) - 1;
+
+	// The bit of each unit of a vector in the bits of its real mask.
+	VectorMask unit_bits;
+	for(size_t k = 0; k < vector_size; k++)
+	{
+		unit_bits[k] = static_cast<typename Vector::MaskLane>(1) << k;
+	}
+
+	size_t const vector_end = unit_count - unit_count % vector_size;
+	for(size_t word_start = 0; word_start < vector_end; word_start += 64)
+	{
+		uint64_t real_bits = real_mask[word_start / 64];
+		size_t const word_end = std::min<size_t>(word_start + 64, vector_end);
+		for(size_t id = word_start; id < word_end; id += vector_size)
+		{
+			VectorValues parent;
+			VectorValues child;
+			std::memcpy(&parent, values + id, sizeof(parent));
+			std::memcpy(&child, child_values + id, sizeof(child));
+			VectorValues const sum = parent + child;
+
+			// There is no branch on the mask, the real units are mixed with
+			// the others in most rows. Keep the real units as they are, even
+			// `-0`, instead of adding `0` to them.
+			VectorMask const is_real = (
+				(VectorMask{} + static_cast<typename Vector::MaskLane>(real_bits & vector_bits)) &
+				unit_bits
+			) == unit_bits;
+			real_bits >>= vector_size;
+
+			// Casting a vector to another vector type of the same size keeps
+			// its bits.
+			VectorMask const result = (
+				((VectorMask)parent & is_real) | ((VectorMask)sum & ~is_real)
+			);
+			std::memcpy(values + id, &result, sizeof(result));
+		}
+	}
+	for(size_t id = vector_end; id < unit_count; id++)
+	{
+		if(((real_mask[id / 64] >> (id % 64)) & 1) == 0)
+		{
+			Values::add(values[id], child_values[id]);
+		}
+	}
+}
+#endif
+
+// Like `add_child_units_scalar()`, keeping the error of each sum in
+// `compensations`.
+template<typename Values>
+inline void add_child_units_compensated(
+	typename Values::Value * values, typename Values::Value * compensations,
+	typename Values::Value const * child_values, uint64_t const * real_mask,
+	size_t unit_count
+)
+{
+	for(size_t id = 0; id < unit_count; id++)
+	{
+		if(((real_mask[id / 64] >> (id % 64)) & 1) == 0)
+		{
+			Values::add(values[id], compensations[id], child_values[id]);
+		}
+	}
+}
+
+// `compensations` holds one value per unit, set to 0 before adding the first
+// child. It is only used by the compensated backends.
+template<typename Values>
+inline void add_child_units(
+	typename Values::Value * values, typename Values::Value * compensations,
+	typename Values::Value const * child_values, uint64_t const * real_mask,
+	size_t unit_count
+)
+{
+	if constexpr(Values::IS_COMPENSATED)
+	{
+		add_child_units_compensated<Values>(
+			values, compensations, child_values, real_mask, unit_count
+		);
+	}
+	else
+	{
+#if defined(LORG_UNIT_SUM_VECTOR)
+		add_child_units_vector<Values>(values, child_values, real_mask, unit_count);
+#else
+		add_child_units_scalar<Values>(values, child_values, real_mask, unit_count);
+#endif
+	}
+}
+
+// Correct the sums by their compensations once all the children are added.
+template<typename Values>
+inline void finish_child_units(
+	typename Values::Value * values, typename Values::Value const * compensations,
+	uint64_t const * real_mask, size_t unit_count
+)
+{
+	if constexpr(Values::IS_COMPENSATED)
+	{
+		for(size_t id = 0; id < unit_count; id++)
+		{
+			if(((real_mask[id / 64] >> (id % 64)) & 1) == 0)
+			{
+				values[id] = Values::finish(values[id], compensations[id]);
+			}
+		}
+	}
+}
+}
+
+#endif
@@ -0,0 +1,330 @@
+#ifndef LORG_UNIT_VALUE_HPP
+#define LORG_UNIT_VALUE_HPP
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <string_view>
+#include <system_error>
+
+#if !defined(__cpp_lib_to_chars)
+// The standard libraries without `std::from_chars()` for floats.
+#include <cerrno>
+#include <cstdlib>
+#include <string>
+#endif
+
+namespace lorg
+{
+
+// The digits of a unit value read by `read_decimal_number()`. The number is
+// `±significand × 10^exponent` when it is exact, which is when its
+// significant digits fit in `significand`.
+struct DecimalNumber
+{
+	bool is_negative = false;
+	// Without the trailing zeros, which are counted in `exponent`.
+	uint64_t significand = 0;
+	int64_t exponent = 0;
+	bool is_exact = true;
+	// The number without its `+` sign, to read the numbers that are not exact.
+	std::string_view text;
+};
+
+// A `uint64_t` holds all the numbers of 19 digits.
+constexpr int DECIMAL_SIGNIFICAND_MAX_DIGITS = 19;
+
+// Read a unit value, which should be in the format `/[-+]?\d*(\.\d+)?/` with at
+// least a digit, in a single pass over its characters. Returns false if it is
+// ill-formed.
+inline bool read_decimal_number(std::string_view str, DecimalNumber & number) noexcept
+{
+	number = DecimalNumber();
+	size_t i = 0;
+	if(!str.empty() && (str[0] == '-' || str[0] == '+'))
+	{
+		number.is_negative = str[0] == '-';
+		i = 1;
+	}
+	number.text = str.substr(!str.empty() && str[0] == '+' ? 1 : 0);
+
+	bool has_digits = false;
+	bool has_decimal_point = false;
+	bool has_decimals = false;
+	int significant_digit_count = 0;
+	// The zeros after the last nonzero digit, which are only added to the
+	// significand if another nonzero digit comes.
+	int64_t zero_count = 0;
+	for(; i < str.size(); i++)
+	{
+		char const c = str[i];
+		if(c == '.' && !has_decimal_point)
+		{
+			has_decimal_point = true;
+			continue;
+		}
+		if(c < '0' || '9' < c)
+		{
+			return false;
+		}
+		has_digits = true;
+		has_decimals = has_decimal_point;
+		number.exponent -= has_decimal_point ? 1 : 0;
+		if(!number.is_exact)
+		{
+			continue;
+		}
+		if(c == '0')
+		{
+			// The leading zeros are not significant.
+			zero_count += number.significand != 0 ? 1 : 0;
+			continue;
+		}
+		if(significant_digit_count + zero_count >= DECIMAL_SIGNIFICAND_MAX_DIGITS)
+		{
+			number.is_exact = false;
+			continue;
+		}
+		for(; zero_count > 0; zero_count--)
+		{
+			number.significand *= 10;
+			significant_digit_count++;
+		}
+		number.significand = number.significand * 10 + static_cast<uint64_t>(c - '0');
+		significant_digit_count++;
+	}
+	number.exponent += zero_count;
+	return has_digits && has_decimals == has_decimal_point;
+}
+
+// Convert an exact number to a floating-point value when its significand and
+// the power of ten are both exact in `Value`: a single multiplication or
+// division then rounds the result correctly. Returns false if the number is
+// not one of them.
+template<typename Value, uint64_t max_significand, int64_t max_exponent>
+inline bool convert_exact_decimal_number(DecimalNumber const & number, Value & value) noexcept
+{
+	if(!number.is_exact)
+	{
+		return false;
+	}
+	if(number.significand == 0)
+	{
+		value = number.is_negative ? -Value(0) : Value(0);
+		return true;
+	}
+	if(
+		number.significand > max_significand ||
+		number.exponent < -max_exponent || number.exponent > max_exponent
+	)
+	{
+		return false;
+	}
+
+	Value power = 1;
+	for(int64_t e = number.exponent < 0 ? -number.exponent : number.exponent; e > 0; e--)
+	{
+		power *= 10;
+	}
+	value = static_cast<Value>(number.significand);
+	value = number.exponent < 0 ? value / power : value * power;
+	value = number.is_negative ? -value : value;
+	return true;
+}
+
+// Convert any number to a floating-point value. Returns false if it is beyond
+// the values of `Value`.
+template<typename Value>
+inline bool convert_decimal_number_text(DecimalNumber const & number, Value & value) noexcept
+{
+#if defined(__cpp_lib_to_chars)
+	std::from_chars_result const result = std::from_chars(
+		number.text.data(), number.text.data() + number.text.size(), value,
+		std::chars_format::fixed
+	);
+	// Like `strtof()`, the values too small to keep all their precision are
+	// out of range too.
+	return result.ec == std::errc() && std::fpclassify(value) != FP_SUBNORMAL;
+#else
+	std::string const terminated(number.text);
+	errno = 0;
+	if constexpr(sizeof(Value) == sizeof(float))
+	{
+		value = std::strtof(terminated.c_str(), nullptr);
+	}
+	else
+	{
+		value = std::strtod(terminated.c_str(), nullptr);
+	}
+	return errno != ERANGE;
+#endif
+}
+
+// The backends storing and summing the unit values. One of them is chosen
+// when lorg is built, see `UnitValues`, and the code summing the values takes
+// it as a template parameter, so nothing is decided while summing. A backend
+// has:
+// - `Value`, the type of the values;
+// - `TYPE`, which tells apart the compiled trees of each backend;
+// - `read()`, which converts a number read by `read_decimal_number()` and
+//   returns false if the backend cannot represent it;
+// - `add()`, which adds a value to a sum;
+// - `to_double()`, for the formats the backend cannot write exactly.
+//
+// The backends with `IS_COMPENSATED` also have an `add()` keeping the error
+// of the sum in a compensation, which starts at 0, and `finish()`, which
+// returns the sum corrected by its compensation.
+
+// The fastest values to sum, with about 7 significant digits. The sums of
+// many values drift.
+struct FloatUnitValues
+{
+	using Value = float;
+	static constexpr uint64_t TYPE = 1;
+	static constexpr bool IS_COMPENSATED = false;
+
+	// The integers up to 2^24 and the powers of ten up to 10^10 are exact.
+	static bool read(DecimalNumber const & number, Value & value) noexcept
+	{
+		return (
+			convert_exact_decimal_number<Value, uint64_t(1) << 24, 10>(number, value) ||
+			convert_decimal_number_text(number, value)
+		);
+	}
+
+	static void add(Value & sum, Value value) noexcept
+	{
+		sum += value;
+	}
+
+	static double to_double(Value value) noexcept
+	{
+		return value;
+	}
+};
+
+// Values with about 16 significant digits. The children of a node are summed
+// with Kahan's compensation, so the error of a sum does not grow with the
+// number of children.
+struct DoubleUnitValues
+{
+	using Value = double;
+	static constexpr uint64_t TYPE = 2;
+	static constexpr bool IS_COMPENSATED = true;
+
+	// The integers up to 2^53 and the powers of ten up to 10^22 are exact.
+	static bool read(DecimalNumber const & number, Value & value) noexcept
+	{
+		return (
+			convert_exact_decimal_number<Value, uint64_t(1) << 53, 22>(number, value) ||
+			convert_decimal_number_text(number, value)
+		);
+	}
+
+	static void add(Value & sum, Value value) noexcept
+	{
+		sum += value;
+	}
+
+	static void add(Value & sum, Value & compensation, Value value) noexcept
+	{
+		Value const corrected_value = value - compensation;
+		Value const new_sum = sum + corrected_value;
+		// What was added too much, removed from the next value.
+		compensation = (new_sum - sum) - corrected_value;
+		sum = new_sum;
+	}
+
+	static Value finish(Value sum, Value compensation) noexcept
+	{
+		return sum - compensation;
+	}
+
+	static double to_double(Value value) noexcept
+	{
+		return value;
+	}
+};
+
+constexpr int FIXED_POINT_DIGITS = 6;
+constexpr int64_t FIXED_POINT_SCALE = 1000000;
+
+// Exact values and sums, stored as a number of 10^-`FIXED_POINT_DIGITS`. The
+// values with more decimals, or beyond about ±9.2 × 10^12, cannot be read.
+// The sums beyond wrap around.
+struct FixedPointUnitValues
+{
+	using Value = int64_t;
+	static constexpr uint64_t TYPE = 3;
+	static constexpr bool IS_COMPENSATED = false;
+
+	// The digits are used as they are, without converting them to a binary
+	// fraction first.
+	static bool read(DecimalNumber const & number, Value & value) noexcept
+	{
+		// A number with more significant digits has more than 19 digits once
+		// scaled, or more decimals than kept.
+		if(!number.is_exact)
+		{
+			return false;
+		}
+		uint64_t const max_magnitude = (
+			number.is_negative ? uint64_t(INT64_MAX) + 1 : uint64_t(INT64_MAX)
+		);
+
+		uint64_t magnitude = number.significand;
+		if(magnitude != 0)
+		{
+			// The significand has no trailing zeros, so nothing can be dropped.
+			int64_t const scale_exponent = number.exponent + FIXED_POINT_DIGITS;
+			if(scale_exponent < 0)
+			{
+				return false;
+			}
+			for(int64_t e = 0; e < scale_exponent; e++)
+			{
+				if(magnitude > max_magnitude / 10)
+				{
+					return false;
+				}
+				magnitude *= 10;
+			}
+			if(magnitude > max_magnitude)
+			{
+				return false;
+			}
+		}
+
+		// The magnitude of the lowest value does not fit in a `Value`.
+		value = (
+			number.is_negative && magnitude > 0 ?
+			-static_cast<Value>(magnitude - 1) - 1 : static_cast<Value>(magnitude)
+		);
+		return true;
+	}
+
+	static void add(Value & sum, Value value) noexcept
+	{
+		sum = static_cast<Value>(static_cast<uint64_t>(sum) + static_cast<uint64_t>(value));
+	}
+
+	static double to_double(Value value) noexcept
+	{
+		return static_cast<double>(value) / static_cast<double>(FIXED_POINT_SCALE);
+	}
+};
+
+// Define `LORG_DOUBLE_UNIT_VALUES` or `LORG_FIXED_POINT_UNIT_VALUES` to store
+// the unit values in another backend than floats.
+#if defined(LORG_DOUBLE_UNIT_VALUES)
+using UnitValues = DoubleUnitValues;
+#elif defined(LORG_FIXED_POINT_UNIT_VALUES)
+using UnitValues = FixedPointUnitValues;
+#else
+using UnitValues = FloatUnitValues;
+#endif
+
+using UnitValue = UnitValues::Value;
+}
+
+#endif